@@ -0,0 +1,545 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bitboard.h"
+#include "board.h"
+#include "game.h"
+#include "population.h"
+#include "representation.h"
+#include "rng.h"
+#include "tournament.h"
+
+using namespace std;
+
+// Every heap allocation the program makes is counted, so the benchmarks can check paths that shouldn't allocate
+static atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+
+	if (void* out = malloc(max<size_t>(size, 1))) {
+		return out;
+	}
+	throw bad_alloc();
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+	allocations.fetch_add(1, memory_order_relaxed);
+
+	// aligned_alloc wants the size to be a multiple of the alignment
+	size_t align = static_cast<size_t>(alignment);
+	if (void* out = aligned_alloc(align, (max<size_t>(size, 1) + align - 1) / align * align)) {
+		return out;
+	}
+	throw bad_alloc();
+}
+
+// Kept out of line: inlined into library code, the free would sit next to an operator new call and GCC would report it
+// as a mismatched deallocation, not knowing that new here is malloc underneath
+[[gnu::noinline]] void operator delete(void* pointer) noexcept { free(pointer); }
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+[[gnu::noinline]] void operator delete(void* pointer, align_val_t) noexcept { free(pointer); }
+[[gnu::noinline]] void operator delete(void* pointer, size_t, align_val_t) noexcept { free(pointer); }
+
+// Standalone benchmarks, built from the same sources as train with this file in place of train.cpp:
+//   ./bench [positions] [population]
+
+static const Precisions PRECISIONS[3] = {Precisions::DOUBLE, Precisions::FLOAT, Precisions::FIXED16};
+static const string PRECISION_NAMES[3] = {"double", "float", "int16"};
+
+// Positions reached by random play from the start that still have moves to make, as games. A game is cut off after 200
+// half-moves like the driver's, so the sample stays spread over openings, middlegames and endings rather than one long
+// shuffle of bare kings.
+static vector<Game> sampleGames(size_t count) {
+	vector<Game> out;
+	Game game;
+	uint halfMoves = 0;
+
+	while (out.size() < count) {
+		vector<Move> moves = game.getAvailableMoves();
+
+		if (moves.empty() || halfMoves++ == 200) {
+			game = Game();
+			halfMoves = 0;
+			continue;
+		}
+
+		out.push_back(game);
+
+		Move move = moves[rng::randu(moves.size() - 1)];
+		playMove(game, move, PieceTypes::QUEEN);
+	}
+
+	return out;
+}
+
+// the same positions as Boards, to evaluate against
+static vector<Board> samplePositions(size_t count) {
+	vector<Game> games = sampleGames(count);
+
+	return vector<Board>(games.begin(), games.end());
+}
+
+static void benchEvaluation(size_t positions) {
+	vector<Board> boards = samplePositions(positions);
+	Individual individual(true);
+
+	cout << "Evaluation throughput over " << boards.size() << " positions" << endl;
+
+	for (int p = 0; p < 3; p++) {
+		double checksum = 0;
+		auto start = chrono::steady_clock::now();
+
+		for (int repeat = 0; repeat < 10; repeat++) {
+			for (const Board& board : boards) {
+				checksum += individual.evaluatePosition(board, Players::WHITE, PRECISIONS[p]);
+			}
+		}
+
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		cout << "  " << PRECISION_NAMES[p] << ": " << (boards.size() * 10 / elapsed.count() / 1e6) << "M evals/s (checksum " << checksum << ")"
+			 << endl;
+	}
+}
+
+// Scores every candidate move of each position one call at a time, then with one batched call per position. Returns
+// whether every batched score equalled its single one, as evaluateMoves promises.
+static bool benchCandidates(size_t positions) {
+	vector<Game> games = sampleGames(positions);
+	vector<Board> boards(games.begin(), games.end());
+	vector<vector<Candidate>> moves(games.size());
+	size_t candidates = 0;
+	for (size_t i = 0; i < games.size(); i++) {
+		boards[i].expand(games[i].getAvailableMoves(), moves[i]);
+		candidates += moves[i].size();
+	}
+
+	Individual individual(true);
+	vector<double> scores(256);
+	bool exact = true;
+
+	cout << "Candidate scoring over " << candidates << " moves" << endl;
+
+	for (int p = 0; p < 3; p++) {
+		size_t mismatches = 0;
+		chrono::duration<double> single = chrono::duration<double>::max(), batched = chrono::duration<double>::max();
+
+		// best of several interleaved runs, as the two are close enough that a single run's noise decides the order
+		for (int repeat = 0; repeat < 5; repeat++) {
+			auto start = chrono::steady_clock::now();
+
+			for (size_t i = 0; i < boards.size(); i++) {
+				double base = individual.evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]);
+
+				for (const Candidate& candidate : moves[i]) {
+					individual.evaluateMove(boards[i], candidate, Players::WHITE, base, PRECISIONS[p]);
+				}
+			}
+
+			single = min<chrono::duration<double>>(single, chrono::steady_clock::now() - start);
+			start = chrono::steady_clock::now();
+
+			for (size_t i = 0; i < boards.size(); i++) {
+				double base = individual.evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]);
+				scores.resize(moves[i].size());
+				individual.evaluateMoves(boards[i], moves[i], Players::WHITE, base, scores.data(), PRECISIONS[p]);
+			}
+
+			batched = min<chrono::duration<double>>(batched, chrono::steady_clock::now() - start);
+		}
+
+		for (size_t i = 0; i < boards.size(); i++) {
+			double base = individual.evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]);
+			scores.resize(moves[i].size());
+			individual.evaluateMoves(boards[i], moves[i], Players::WHITE, base, scores.data(), PRECISIONS[p]);
+
+			for (size_t k = 0; k < moves[i].size(); k++) {
+				mismatches += scores[k] != individual.evaluateMove(boards[i], moves[i][k], Players::WHITE, base, PRECISIONS[p]);
+			}
+		}
+
+		cout << "  " << PRECISION_NAMES[p] << ": " << (candidates / single.count() / 1e6) << "M/s one at a time, " << (candidates / batched.count() / 1e6)
+			 << "M/s batched (" << mismatches << " of " << candidates << " scores differ)" << endl;
+		exact = exact && mismatches == 0;
+	}
+
+	return exact;
+}
+
+// Scores each position for a whole population, genome by genome and then with the population-major layout. Returns
+// whether the two agreed exactly, as the tree driver relies on them choosing the same moves.
+static bool benchPopulation(size_t positions, size_t size) {
+	vector<Board> boards = samplePositions(positions / 10);
+	vector<Individual> population;
+	for (size_t i = 0; i < size; i++) {
+		population.push_back(Individual(true));
+	}
+
+	PopulationWeights layout(population);
+	vector<double> scores(size);
+	bool exact = true;
+
+	cout << "Population scoring over " << boards.size() << " positions x " << size << " individuals" << endl;
+
+	for (int p = 0; p < 3; p++) {
+		double worst = 0;
+		auto start = chrono::steady_clock::now();
+
+		for (const Board& board : boards) {
+			for (size_t i = 0; i < size; i++) {
+				scores[i] = population[i].evaluatePosition(board, Players::WHITE, PRECISIONS[p]);
+			}
+		}
+
+		chrono::duration<double> separate = chrono::steady_clock::now() - start;
+		start = chrono::steady_clock::now();
+
+		for (const Board& board : boards) {
+			layout.evaluatePosition(board, Players::WHITE, scores.data(), PRECISIONS[p]);
+		}
+
+		chrono::duration<double> together = chrono::steady_clock::now() - start;
+
+		for (const Board& board : boards) {
+			layout.evaluatePosition(board, Players::WHITE, scores.data(), PRECISIONS[p]);
+
+			for (size_t i = 0; i < size; i++) {
+				worst = max(worst, abs(scores[i] - population[i].evaluatePosition(board, Players::WHITE, PRECISIONS[p])));
+			}
+		}
+
+		double evaluations = boards.size() * size / 1e6;
+		cout << "  " << PRECISION_NAMES[p] << ": " << (evaluations / separate.count()) << "M evals/s per genome, " << (evaluations / together.count())
+			 << "M evals/s population-major (largest difference " << worst << ")" << endl;
+		exact = exact && worst == 0;
+	}
+
+	return exact;
+}
+
+// Scores the candidates of each position for a different genome, as the games of a lockstep batch are, first genome by
+// genome and then batch positions at a time from the population-major layout. Returns whether the two agreed exactly,
+// as lockstep execution relies on them choosing the same moves.
+static bool benchMoveBatches(size_t positions, size_t size, size_t batch) {
+	vector<Game> games = sampleGames(positions / 10);
+	vector<Board> boards(games.begin(), games.end());
+	vector<vector<Candidate>> moves(games.size());
+	size_t candidates = 0;
+	for (size_t i = 0; i < games.size(); i++) {
+		boards[i].expand(games[i].getAvailableMoves(), moves[i]);
+		candidates += moves[i].size();
+	}
+
+	vector<Individual> population;
+	for (size_t i = 0; i < size; i++) {
+		population.push_back(Individual(true));
+	}
+
+	PopulationWeights layout(population);
+	vector<vector<double>> separate(boards.size()), together(boards.size());
+	for (size_t i = 0; i < boards.size(); i++) {
+		separate[i].resize(moves[i].size());
+		together[i].resize(moves[i].size());
+	}
+
+	vector<double> bases(boards.size());
+	vector<PopulationWeights::MoveRequest> requests;
+	bool exact = true;
+
+	cout << "Cross-game candidate scoring over " << candidates << " moves, " << batch << " positions a batch" << endl;
+
+	for (int p = 0; p < 3; p++) {
+		size_t mismatches = 0;
+		for (size_t i = 0; i < boards.size(); i++) {
+			bases[i] = population[i % size].evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]);
+		}
+
+		auto start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < boards.size(); i++) {
+			population[i % size].evaluateMoves(boards[i], moves[i], Players::WHITE, bases[i], separate[i].data(), PRECISIONS[p]);
+		}
+
+		chrono::duration<double> single = chrono::steady_clock::now() - start;
+		start = chrono::steady_clock::now();
+
+		for (size_t first = 0; first < boards.size(); first += batch) {
+			requests.clear();
+			for (size_t i = first; i < min(first + batch, boards.size()); i++) {
+				requests.push_back({.board = &boards[i],
+									.candidates = &moves[i],
+									.perspective = Players::WHITE,
+									.individual = i % size,
+									.base = bases[i],
+									.scores = together[i].data()});
+			}
+
+			layout.evaluateMoves(requests, PRECISIONS[p]);
+		}
+
+		chrono::duration<double> batched = chrono::steady_clock::now() - start;
+
+		for (size_t i = 0; i < boards.size(); i++) {
+			for (size_t k = 0; k < moves[i].size(); k++) {
+				mismatches += separate[i][k] != together[i][k];
+			}
+		}
+
+		cout << "  " << PRECISION_NAMES[p] << ": " << (candidates / single.count() / 1e6) << "M/s per genome, " << (candidates / batched.count() / 1e6)
+			 << "M/s across positions (" << mismatches << " of " << candidates << " scores differ)" << endl;
+		exact = exact && mismatches == 0;
+	}
+
+	return exact;
+}
+
+// Counts heap allocations in the candidate and scoring path the game driver runs every ply, and in whole games once the
+// driver's buffers exist. Neither may make any.
+static bool benchAllocations(size_t positions) {
+	vector<Game> games = sampleGames(positions);
+	vector<Board> boards(games.begin(), games.end());
+	vector<vector<Move>> moves;
+	for (const Game& position : games) {
+		moves.push_back(position.getAvailableMoves());
+	}
+
+	Individual white(true), black(true);
+	vector<double> scores(256);
+	vector<Candidate> candidates;
+	candidates.reserve(256);
+
+	size_t before = allocations.load();
+	for (int p = 0; p < 3; p++) {
+		for (size_t i = 0; i < boards.size(); i++) {
+			boards[i].expand(moves[i], candidates);
+			scores.resize(candidates.size());
+
+			white.evaluateMove(boards[i], candidates[0], Players::WHITE, white.evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]), PRECISIONS[p]);
+			white.evaluateMoves(boards[i], candidates, Players::WHITE, white.evaluatePosition(boards[i], Players::WHITE, PRECISIONS[p]), scores.data(),
+								PRECISIONS[p]);
+		}
+	}
+	size_t evaluation = allocations.load() - before;
+
+	// one game first, so the driver's per-thread buffers exist before counting
+	playGame(white, black);
+
+	size_t halfMoves = 0;
+	before = allocations.load();
+	for (int game = 0; game < 10; game++) {
+		halfMoves += playGame(game % 2 ? white : black, game % 2 ? black : white).halfMoves;
+	}
+	size_t play = allocations.load() - before;
+
+	cout << "Heap allocations: " << evaluation << " scoring " << boards.size() << " positions in every precision, " << play << " playing "
+		 << halfMoves << " half-moves" << endl;
+
+	return evaluation == 0 && play == 0;
+}
+
+// leaf nodes depth plies below game, a promotion counting once per piece it can become
+static uint64_t perft(const BitboardGame& game, int depth) {
+	if (depth == 0) {
+		return 1;
+	}
+
+	uint64_t nodes = 0;
+	for (const Move& move : game.getAvailableMoves()) {
+		if (game.getPiece(move.from).type() == PieceTypes::PAWN && (move.to.rank == 1 || move.to.rank == 8)) {
+			for (const PieceTypes type : {PieceTypes::KNIGHT, PieceTypes::BISHOP, PieceTypes::ROOK, PieceTypes::QUEEN}) {
+				nodes += perft(game.branch(move, type), depth - 1);
+			}
+		} else {
+			nodes += perft(game.branch(move), depth - 1);
+		}
+	}
+
+	return nodes;
+}
+
+// Checks BitboardGame's move generation against published perft counts, once with each slider lookup: the standard
+// positions, which exercise castling, en passant, pins and promotion, then smaller ones aimed at single edge cases.
+// Then times the lookups on their own, and compares evaluating positions through the piece sets with evaluating a Board
+// built from them.
+static bool benchPerft(size_t positions) {
+	struct Case {
+		string fen;
+		int depth;
+		uint64_t nodes;
+	};
+	const Case CASES[19] = {{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 4, 197281},
+						   {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 3, 97862},
+						   {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+						   {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+						   {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 3, 62379},
+						   // en passant that would uncover a rook on the rank, a bishop on the diagonal, or that itself gives check
+						   {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+						   {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+						   {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+						   // castling that gives check, castling through or out of check, and castling the opponent prevents
+						   {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+						   {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+						   {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+						   {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+						   // promoting out of check, into check, to avoid stalemate, and into stalemate or mate
+						   {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+						   {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+						   {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+						   {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+						   {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+						   // discovered and double check
+						   {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+						   {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658}};
+
+	const SliderLookups LOOKUPS[2] = {SliderLookups::MAGIC, SliderLookups::PEXT};
+	const string LOOKUP_NAMES[2] = {"magic", "pext"};
+	SliderLookups original = BitboardGame::sliderLookup();
+
+	bool correct = true;
+	for (int l = 0; l < 2; l++) {
+		BitboardGame::setSliderLookup(LOOKUPS[l]);
+		cout << "Bitboard perft, " << LOOKUP_NAMES[l] << " slider lookups" << endl;
+
+		for (const Case& test : CASES) {
+			auto start = chrono::steady_clock::now();
+			uint64_t nodes = perft(BitboardGame(test.fen), test.depth);
+			chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+			cout << "  " << test.fen << " depth " << test.depth << ": " << nodes << " nodes"
+				 << (nodes == test.nodes ? "" : " (expected " + to_string(test.nodes) + ")") << ", " << (nodes / elapsed.count() / 1e6)
+				 << "M nodes/s" << endl;
+			correct = correct && nodes == test.nodes;
+		}
+	}
+	BitboardGame::setSliderLookup(original);
+
+	vector<Game> games = sampleGames(positions);
+
+	uint64_t checksums[2] = {0, 0};
+	for (int l = 0; l < 2; l++) {
+		BitboardGame::setSliderLookup(LOOKUPS[l]);
+		auto start = chrono::steady_clock::now();
+
+		for (const BitboardGame& position : games) {
+			BitboardGame::Bitboard occupied = position.occupancy();
+
+			for (int square = 0; square < 64; square++) {
+				checksums[l] += BitboardGame::rookAttacks(square, occupied) ^ BitboardGame::bishopAttacks(square, occupied);
+			}
+		}
+
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+		cout << "  " << LOOKUP_NAMES[l] << ": " << (games.size() * 128 / elapsed.count() / 1e6) << "M slider lookups/s (checksum " << checksums[l]
+			 << ")" << endl;
+	}
+	BitboardGame::setSliderLookup(original);
+	correct = correct && checksums[0] == checksums[1];
+
+	Individual individual(true);
+	double bits = 0, squares = 0, error = 0;
+
+	auto start = chrono::steady_clock::now();
+	for (const BitboardGame& position : games) {
+		bits += individual.evaluatePosition(position, Players::WHITE);
+	}
+	chrono::duration<double> bitTime = chrono::steady_clock::now() - start;
+
+	start = chrono::steady_clock::now();
+	for (const BitboardGame& position : games) {
+		squares += individual.evaluatePosition(Board(position), Players::WHITE);
+	}
+	chrono::duration<double> boardTime = chrono::steady_clock::now() - start;
+
+	for (const BitboardGame& position : games) {
+		error = max(error, abs(individual.evaluatePosition(position, Players::WHITE) - individual.evaluatePosition(Board(position), Players::WHITE)));
+	}
+
+	cout << "  evaluating " << games.size() << " positions: " << (games.size() / bitTime.count() / 1e6) << "M evals/s over set bits, "
+		 << (games.size() / boardTime.count() / 1e6) << "M evals/s through Board (checksums " << bits << ", " << squares << ", largest difference "
+		 << error << ")" << endl;
+
+	return correct;
+}
+
+// Plays the same round robin in every precision and reports how often each game, and each individual's rank, matches
+// the double-precision tournament
+static void benchAgreement(size_t size) {
+	vector<Individual> population;
+	for (size_t i = 0; i < size; i++) {
+		population.push_back(Individual(true));
+	}
+
+	vector<vector<Players>> winners(3);
+	vector<vector<int>> wins(3, vector<int>(size, 0));
+
+	for (int p = 0; p < 3; p++) {
+		auto start = chrono::steady_clock::now();
+
+		for (size_t i = 0; i < size; i++) {
+			for (size_t j = 0; j < size; j++) {
+				if (i != j) {
+					GameResult result = playGame(population[i], population[j], Game(), PRECISIONS[p]);
+
+					winners[p].push_back(result.winner);
+					wins[p][result.winner == Players::WHITE ? i : j]++;
+				}
+			}
+		}
+
+		chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+		size_t sameGames = 0, sameOrder = 0, pairs = 0;
+		for (size_t k = 0; k < winners[p].size(); k++) {
+			sameGames += winners[p][k] == winners[0][k];
+		}
+		for (size_t i = 0; i < size; i++) {
+			for (size_t j = i + 1; j < size; j++) {
+				sameOrder += (wins[p][i] > wins[p][j]) == (wins[0][i] > wins[0][j]) && (wins[p][i] < wins[p][j]) == (wins[0][i] < wins[0][j]);
+				pairs++;
+			}
+		}
+
+		cout << "  " << PRECISION_NAMES[p] << ": " << elapsed.count() << "s, " << (100.0 * sameGames / winners[p].size()) << "% of games and "
+			 << (100.0 * sameOrder / pairs) << "% of fitness orderings agree with double" << endl;
+	}
+}
+
+int main(int argc, char** argv) {
+	size_t positions = argc > 1 ? stoul(argv[1]) : 100000;
+	size_t population = argc > 2 ? stoul(argv[2]) : 16;
+
+	benchEvaluation(positions);
+	if (!benchCandidates(positions)) {
+		cerr << "Batched candidate scores differ from single ones" << endl;
+		return 1;
+	}
+	if (!benchPopulation(positions, population * 8)) {
+		cerr << "Population-major scores differ from the genomes'" << endl;
+		return 1;
+	}
+	if (!benchMoveBatches(positions, population * 8, 8)) {
+		cerr << "Cross-game candidate scores differ from the genomes'" << endl;
+		return 1;
+	}
+
+	if (!benchAllocations(positions / 10)) {
+		cerr << "The game driver allocated on the heap" << endl;
+		return 1;
+	}
+
+	if (!benchPerft(positions)) {
+		cerr << "Bitboard move generation disagrees with perft" << endl;
+		return 1;
+	}
+
+	cout << "Round robin of " << population << " random individuals" << endl;
+	benchAgreement(population);
+
+	return 0;
+}
\ No newline at end of file
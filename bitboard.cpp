@@ -0,0 +1,779 @@
+#include "bitboard.h"
+
+#include <atomic>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+typedef BitboardGame::Bitboard Bitboard;
+
+enum Kinds { PAWN_KIND, KNIGHT_KIND, BISHOP_KIND, ROOK_KIND, QUEEN_KIND, KING_KIND };
+
+static const PieceTypes TYPES[6] = {PieceTypes::PAWN, PieceTypes::KNIGHT, PieceTypes::BISHOP, PieceTypes::ROOK, PieceTypes::QUEEN, PieceTypes::KING};
+static const int VALUES[6] = {1, 3, 3, 5, 9, 0};
+
+// castling rights, as bits of _castling
+static const int WHITE_KINGSIDE = 1, WHITE_QUEENSIDE = 2, BLACK_KINGSIDE = 4, BLACK_QUEENSIDE = 8;
+
+static const string START = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+static Bitboard bit(int square) { return (Bitboard)1 << square; }
+
+// whether square is on rank 1 or 8, where a pawn promotes
+static bool lastRank(int square) { return (square & 7) == 0 || (square & 7) == 7; }
+
+static int kindOf(PieceTypes type) {
+	switch (type) {
+		case PieceTypes::PAWN:
+			return PAWN_KIND;
+		case PieceTypes::KNIGHT:
+			return KNIGHT_KIND;
+		case PieceTypes::BISHOP:
+			return BISHOP_KIND;
+		case PieceTypes::ROOK:
+			return ROOK_KIND;
+		case PieceTypes::QUEEN:
+			return QUEEN_KIND;
+		case PieceTypes::KING:
+		default:
+			return KING_KIND;
+	}
+}
+
+static int playerIndex(Players player) { return player == Players::WHITE ? 0 : 1; }
+
+// the castling rights that need the piece which starts on square to stay there
+static int castlingUsing(int square) {
+	switch (square) {
+		case 4 * 8:
+			return WHITE_KINGSIDE | WHITE_QUEENSIDE;
+		case 7 * 8:
+			return WHITE_KINGSIDE;
+		case 0:
+			return WHITE_QUEENSIDE;
+		case 4 * 8 + 7:
+			return BLACK_KINGSIDE | BLACK_QUEENSIDE;
+		case 7 * 8 + 7:
+			return BLACK_KINGSIDE;
+		case 7:
+			return BLACK_QUEENSIDE;
+		default:
+			return 0;
+	}
+}
+
+// squares reachable in one fixed step, for the pieces whose moves don't depend on what's in the way
+struct StepTables {
+	Bitboard knight[64];
+	Bitboard king[64];
+	Bitboard pawn[2][64];  // captures only, by player
+};
+
+static StepTables makeStepTables() {
+	StepTables out = {};
+
+	auto steps = [](int square, const int (*offsets)[2], int count) {
+		Bitboard targets = 0;
+
+		for (int i = 0; i < count; i++) {
+			int file = (square >> 3) + offsets[i][0], rank = (square & 7) + offsets[i][1];
+
+			if (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+				targets |= bit(file * 8 + rank);
+			}
+		}
+
+		return targets;
+	};
+
+	const int knight[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+	const int king[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+	const int whitePawn[2][2] = {{-1, 1}, {1, 1}}, blackPawn[2][2] = {{-1, -1}, {1, -1}};
+
+	for (int square = 0; square < 64; square++) {
+		out.knight[square] = steps(square, knight, 8);
+		out.king[square] = steps(square, king, 8);
+		out.pawn[0][square] = steps(square, whitePawn, 2);
+		out.pawn[1][square] = steps(square, blackPawn, 2);
+	}
+
+	return out;
+}
+
+static const StepTables STEPS = makeStepTables();
+
+// squares a slider on square sees in one direction, up to and including the first occupied one
+static Bitboard ray(int square, int fileStep, int rankStep, Bitboard occupied) {
+	Bitboard out = 0;
+
+	for (int file = (square >> 3) + fileStep, rank = (square & 7) + rankStep; file >= 0 && file < 8 && rank >= 0 && rank < 8;
+		 file += fileStep, rank += rankStep) {
+		out |= bit(file * 8 + rank);
+
+		if (occupied & bit(file * 8 + rank)) {
+			break;
+		}
+	}
+
+	return out;
+}
+
+static Bitboard softwarePext(Bitboard value, Bitboard mask) {
+	Bitboard out = 0;
+
+	for (Bitboard place = 1; mask != 0; mask &= mask - 1, place <<= 1) {
+		if (value & mask & -mask) {
+			out |= place;
+		}
+	}
+
+	return out;
+}
+
+static Bitboard pext(Bitboard value, Bitboard mask) {
+#if defined(__BMI2__)
+	return _pext_u64(value, mask);
+#else
+	return softwarePext(value, mask);
+#endif
+}
+
+// Attack tables for one kind of slider. Each square owns 2^bits consecutive entries of both tables, bits being the
+// number of squares that could block it (the edge square of a ray never blocks anything behind it, so it's left out).
+struct SliderTable {
+	Bitboard masks[64];
+	Bitboard magics[64];
+	int shifts[64];
+	size_t offsets[64];
+
+	vector<Bitboard> magicAttacks;
+	vector<Bitboard> pextAttacks;
+
+	Bitboard magic(int square, Bitboard occupied) const {
+		return magicAttacks[offsets[square] + (((occupied & masks[square]) * magics[square]) >> shifts[square])];
+	}
+
+	Bitboard pext(int square, Bitboard occupied) const { return pextAttacks[offsets[square] + ::pext(occupied, masks[square])]; }
+};
+
+// Magic numbers for this square numbering, as the search in makeSliderTable finds them. Searching from scratch takes
+// some 14M candidates, nearly half a second at startup, so the results are kept here and only checked when filling in.
+static const Bitboard ROOK_MAGICS[64] = {
+	0x008000908064c000, 0x0040200040001000, 0x0180100080a0010a, 0x8880041000800800,
+	0x1200100201200804, 0x0200020004011008, 0x2180010000800600, 0x0200005088210204,
+	0x0400800040008021, 0x0400400020005000, 0x8240801000200080, 0x8611001004200900,
+	0x008180800c001800, 0x0100800200800400, 0x0a02000102000408, 0x8020802300104280,
+	0x0080004000402000, 0xe010104000402000, 0x0800808010002000, 0xa280210008100100,
+	0x0001818014000800, 0xa002010100080400, 0x0080240001020870, 0x0001020004048845,
+	0x0081826280004004, 0x2020810900284000, 0x0200100080802000, 0x0200080080100080,
+	0x8083080100100500, 0x4406000901000400, 0x0005020080800100, 0x0090204200008114,
+	0x0010400094800420, 0x0900804000802002, 0x0201001841002000, 0x4100080080801000,
+	0x4540040080800800, 0x0002001004040020, 0x0281195814001002, 0x1240800040800100,
+	0x0880042000524004, 0x02c080410206002c, 0x0801200241050010, 0x8400080010008080,
+	0x0008000500090010, 0x0082009084020008, 0x4012000108020004, 0x9000104d08860004,
+	0x2004204114800100, 0x0148802112400300, 0x0202842000100880, 0x001b080080900080,
+	0x001a002008100600, 0x0004008004020080, 0x5181000600040300, 0x0000044401128a00,
+	0x8044110480002441, 0x2008110084402202, 0x90806005090010c1, 0x000420310a004a42,
+	0x0023001004020801, 0x0882001008040102, 0x000230088118020c, 0x0000019025040042};
+
+static const Bitboard BISHOP_MAGICS[64] = {
+	0x0020428400408200, 0x2008010104210004, 0x02d0009200480190, 0x0018158b00010100,
+	0x02c4042132048008, 0x020082202000c221, 0x4000421050080009, 0x0210140202022020,
+	0x00c0101410042248, 0x0405204800d48080, 0x3800c89200420002, 0x180844124a020440,
+	0x04403410a8002221, 0x4040209004200400, 0x084004020202a204, 0x3010002104022000,
+	0x00200240a9110900, 0x2302800404080210, 0x0204188800240010, 0x8048000c01401200,
+	0x120c001a11040900, 0x0000401200500440, 0x00004040840420a0, 0x0020930822880804,
+	0x4044401090900161, 0x0034100015210804, 0x8004100009010120, 0x48c8080000820500,
+	0x0080848004002000, 0x0801004012005044, 0x000080902c040400, 0x0004009005004100,
+	0x0b103010048a0200, 0x8004100203181a00, 0x0800140200100080, 0x8401010800910040,
+	0x0840010011290040, 0x40100214202e1000, 0x0842040040010840, 0x0028010040010860,
+	0x00080202a2051000, 0x4200841008084204, 0x0021120110000d02, 0x48c1004208000084,
+	0x0010088100414400, 0x0021101000420580, 0x0010040558401410, 0x200c0c82a1050205,
+	0x0011108820088000, 0x0001011910120402, 0x1580008608091248, 0x8010018020880c02,
+	0x20a1101032088480, 0x0080100408082800, 0x28100401140401c0, 0x8002102200930012,
+	0x4001040082080200, 0x082200a498081808, 0x000508610080d003, 0x0052020044842402,
+	0x4800a00140c84840, 0x5000000848080820, 0x0101086004240040, 0x0028280808005014};
+
+// Fills in a table by walking every blocker subset of every square on an otherwise empty board. A magic works when it
+// maps every subset to a slot that is free or already holds the same attacks; the known one is tried first, then sparse
+// random candidates until one works. The search is seeded, so startup is deterministic and doesn't touch the training
+// RNG.
+static SliderTable makeSliderTable(const int (*directions)[2], const Bitboard* known) {
+	SliderTable out;
+	uint64_t seed = 0x2545f4914f6cdd1d;
+
+	auto random = [&seed]() {
+		seed ^= seed >> 12;
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		return seed * 0x2545f4914f6cdd1d;
+	};
+
+	size_t total = 0;
+	for (int square = 0; square < 64; square++) {
+		Bitboard mask = 0;
+
+		for (int d = 0; d < 4; d++) {
+			// every square of the empty ray but its last, from which the ray goes no further
+			for (Bitboard reach = ray(square, directions[d][0], directions[d][1], 0); reach != 0; reach &= reach - 1) {
+				int at = countr_zero(reach);
+
+				if (ray(at, directions[d][0], directions[d][1], 0) != 0) {
+					mask |= bit(at);
+				}
+			}
+		}
+
+		out.masks[square] = mask;
+		out.shifts[square] = 64 - popcount(mask);
+		out.offsets[square] = total;
+		total += (size_t)1 << popcount(mask);
+	}
+
+	out.magicAttacks.resize(total);
+	out.pextAttacks.resize(total);
+
+	vector<Bitboard> subsets, attacks;
+	vector<int> tried;
+	for (int square = 0; square < 64; square++) {
+		Bitboard mask = out.masks[square];
+		size_t size = (size_t)1 << popcount(mask);
+		Bitboard* magicSlots = &out.magicAttacks[out.offsets[square]];
+
+		subsets.clear();
+		attacks.clear();
+
+		// carry-rippler: steps through every subset of mask, ending back at the empty set
+		Bitboard occupied = 0;
+		do {
+			Bitboard seen = 0;
+			for (int d = 0; d < 4; d++) {
+				seen |= ray(square, directions[d][0], directions[d][1], occupied);
+			}
+
+			subsets.push_back(occupied);
+			attacks.push_back(seen);
+			out.pextAttacks[out.offsets[square] + softwarePext(occupied, mask)] = seen;
+
+			occupied = (occupied - mask) & mask;
+		} while (occupied != 0);
+
+		// tried[slot] holds the attempt that last wrote magicSlots[slot], so slots needn't be cleared between attempts
+		tried.assign(size, 0);
+		for (int attempt = 1;; attempt++) {
+			Bitboard magic = attempt == 1 ? known[square] : random() & random() & random();
+
+			if (attempt > 1 && popcount((mask * magic) >> 56) < 6) {
+				continue;
+			}
+
+			bool works = true;
+			for (size_t i = 0; i < subsets.size() && works; i++) {
+				size_t slot = (subsets[i] * magic) >> out.shifts[square];
+
+				if (tried[slot] != attempt) {
+					tried[slot] = attempt;
+					magicSlots[slot] = attacks[i];
+				} else {
+					works = magicSlots[slot] == attacks[i];
+				}
+			}
+
+			if (works) {
+				out.magics[square] = magic;
+				break;
+			}
+		}
+	}
+
+	return out;
+}
+
+static const int ROOK_DIRECTIONS[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+static const int BISHOP_DIRECTIONS[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+static const SliderTable ROOKS = makeSliderTable(ROOK_DIRECTIONS, ROOK_MAGICS);
+static const SliderTable BISHOPS = makeSliderTable(BISHOP_DIRECTIONS, BISHOP_MAGICS);
+
+// squares strictly between two squares on a shared rank, file or diagonal, and none for squares that share no line
+struct LineTables {
+	Bitboard between[64][64];
+};
+
+static LineTables makeLineTables() {
+	LineTables out = {};
+	const int directions[8][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+	for (int square = 0; square < 64; square++) {
+		for (const auto& direction : directions) {
+			Bitboard passed = 0;
+
+			for (int file = (square >> 3) + direction[0], rank = (square & 7) + direction[1]; file >= 0 && file < 8 && rank >= 0 && rank < 8;
+				 file += direction[0], rank += direction[1]) {
+				out.between[square][file * 8 + rank] = passed;
+				passed |= bit(file * 8 + rank);
+			}
+		}
+	}
+
+	return out;
+}
+
+static const LineTables LINES = makeLineTables();
+
+static atomic<SliderLookups> lookup{SliderLookups::MAGIC};
+
+// read from START once and copied after that, so starting a game doesn't parse a string or allocate
+static const BitboardGame& startPosition() {
+	static const BitboardGame start(START);
+
+	return start;
+}
+
+BitboardGame::BitboardGame() : BitboardGame(startPosition()) {}
+
+BitboardGame::BitboardGame(const string& fen)
+	: _pieces{}, _occupancy{}, _turn(0), _castling(0), _enPassant(-1), _halfMoveClock(0), _fullMoves(1) {
+	istringstream fields(fen);
+	string placement, side = "w", castling = "-", enPassant = "-", halfMoveClock = "0", fullMoves = "1";
+	fields >> placement >> side >> castling >> enPassant >> halfMoveClock >> fullMoves;
+
+	int file = 0, rank = 7;
+	for (char c : placement) {
+		if (c == '/') {
+			rank--;
+			file = 0;
+		} else if (isdigit(c)) {
+			file += c - '0';
+		} else {
+			size_t kind = string("pnbrqk").find(tolower(c));
+
+			if (kind == string::npos || file > 7 || rank < 0) {
+				throw invalid_argument("Unreadable FEN: " + fen);
+			}
+
+			_pieces[isupper(c) ? 0 : 1][kind] |= bit(file * 8 + rank);
+			file++;
+		}
+	}
+
+	for (int player = 0; player < 2; player++) {
+		for (int kind = 0; kind < 6; kind++) {
+			_occupancy[player] |= _pieces[player][kind];
+		}
+	}
+
+	_turn = side == "b" ? 1 : 0;
+
+	for (char c : castling) {
+		_castling |= c == 'K' ? WHITE_KINGSIDE : c == 'Q' ? WHITE_QUEENSIDE : c == 'k' ? BLACK_KINGSIDE : c == 'q' ? BLACK_QUEENSIDE : 0;
+	}
+
+	if (enPassant.size() == 2) {
+		_enPassant = (enPassant[0] - 'a') * 8 + enPassant[1] - '1';
+	}
+
+	_halfMoveClock = stoul(halfMoveClock);
+	_fullMoves = stoul(fullMoves);
+}
+
+vector<Move> BitboardGame::getAvailableMoves() const {
+	vector<Move> out;
+	getAvailableMoves(out);
+
+	return out;
+}
+
+void BitboardGame::getAvailableMoves(vector<Move>& out) const {
+	out.clear();
+
+	generate([&out](const Move& move) {
+		out.push_back(move);
+		return true;
+	});
+}
+
+bool BitboardGame::hasAnyLegalMove() const {
+	return generate([](const Move&) { return false; });
+}
+
+BitboardGame BitboardGame::branch(const Move& move, PieceTypes promotion) const {
+	BitboardGame out = *this;
+	out.move(move, promotion);
+
+	return out;
+}
+
+void BitboardGame::move(const Move& move, PieceTypes promotion) {
+	int from = square(move.from), to = square(move.to), moving = kind(from, _turn), promoted = kindOf(promotion);
+
+	if (moving < 0) {
+		throw runtime_error("No piece of the side to move on the square moved from");
+	}
+	if (moving == PAWN_KIND && lastRank(to) && (promoted == PAWN_KIND || promoted == KING_KIND)) {
+		throw invalid_argument("Pawns can only promote to a knight, bishop, rook or queen");
+	}
+
+	play(from, to, promoted);
+}
+
+Players BitboardGame::turn() const { return _turn == 0 ? Players::WHITE : Players::BLACK; }
+
+int BitboardGame::materiel(Players player) const {
+	int total = 0;
+
+	for (int kind = 0; kind < 6; kind++) {
+		total += VALUES[kind] * popcount(_pieces[playerIndex(player)][kind]);
+	}
+
+	return total;
+}
+
+string BitboardGame::dumpFEN() const {
+	string out;
+
+	for (int rank = 7; rank >= 0; rank--) {
+		int empty = 0;
+
+		for (int file = 0; file < 8; file++) {
+			int square = file * 8 + rank, player = _occupancy[0] & bit(square) ? 0 : 1, piece = kind(square, player);
+
+			if (piece < 0) {
+				empty++;
+				continue;
+			}
+
+			if (empty > 0) {
+				out += to_string(empty);
+				empty = 0;
+			}
+
+			char letter = "pnbrqk"[piece];
+			out += player == 0 ? toupper(letter) : letter;
+		}
+
+		if (empty > 0) {
+			out += to_string(empty);
+		}
+		if (rank > 0) {
+			out += '/';
+		}
+	}
+
+	out += _turn == 0 ? " w " : " b ";
+
+	if (_castling == 0) {
+		out += '-';
+	}
+	if (_castling & WHITE_KINGSIDE) {
+		out += 'K';
+	}
+	if (_castling & WHITE_QUEENSIDE) {
+		out += 'Q';
+	}
+	if (_castling & BLACK_KINGSIDE) {
+		out += 'k';
+	}
+	if (_castling & BLACK_QUEENSIDE) {
+		out += 'q';
+	}
+
+	out += ' ';
+	if (_enPassant < 0) {
+		out += '-';
+	} else {
+		out += (char)('a' + (_enPassant >> 3));
+		out += (char)('1' + (_enPassant & 7));
+	}
+
+	return out + " " + to_string(_halfMoveClock) + " " + to_string(_fullMoves);
+}
+
+bool BitboardGame::hasPiece(const Position& position) const { return occupancy() & bit(square(position)); }
+
+Piece BitboardGame::getPiece(const Position& position) const {
+	int at = square(position);
+
+	for (int player = 0; player < 2; player++) {
+		int piece = kind(at, player);
+
+		if (piece >= 0) {
+			return Piece(TYPES[piece], player == 0 ? Players::WHITE : Players::BLACK);
+		}
+	}
+
+	throw runtime_error("No piece on that square");
+}
+
+Bitboard BitboardGame::pieces(Players player, PieceTypes type) const { return _pieces[playerIndex(player)][kindOf(type)]; }
+
+Bitboard BitboardGame::occupancy(Players player) const { return _occupancy[playerIndex(player)]; }
+
+Bitboard BitboardGame::occupancy() const { return _occupancy[0] | _occupancy[1]; }
+
+int BitboardGame::square(const Position& position) { return position.file * 8 + position.rank - 1; }
+
+Position BitboardGame::position(int square) { return {.file = (Files)(square >> 3), .rank = (uint)(square & 7) + 1}; }
+
+BitboardGame::Bitboard BitboardGame::rookAttacks(int square, Bitboard occupied) {
+	return lookup.load(memory_order_relaxed) == SliderLookups::PEXT ? ROOKS.pext(square, occupied) : ROOKS.magic(square, occupied);
+}
+
+BitboardGame::Bitboard BitboardGame::bishopAttacks(int square, Bitboard occupied) {
+	return lookup.load(memory_order_relaxed) == SliderLookups::PEXT ? BISHOPS.pext(square, occupied) : BISHOPS.magic(square, occupied);
+}
+
+void BitboardGame::setSliderLookup(SliderLookups value) { lookup.store(value, memory_order_relaxed); }
+
+SliderLookups BitboardGame::sliderLookup() { return lookup.load(memory_order_relaxed); }
+
+// Moves are generated legal from the start. The pieces checking the king and the pieces pinned to it are found once per
+// position, and each piece's targets are cut down to the squares that answer the check and stay on its pin line, so no
+// move has to be played out to see whether it leaves the king attacked.
+template <typename Emit>
+bool BitboardGame::generate(const Emit& emit) const {
+	if (_pieces[_turn][KING_KIND] == 0) {
+		return false;
+	}
+
+	int us = _turn, them = 1 - us;
+	Bitboard own = _occupancy[us], enemy = _occupancy[them], occupied = own | enemy;
+	Bitboard king = _pieces[us][KING_KIND];
+	int from = countr_zero(king);
+
+	// true once emit has asked to stop
+	auto emitAll = [&emit](int from, Bitboard targets) {
+		for (; targets != 0; targets &= targets - 1) {
+			if (!emit(Move{.from = position(from), .to = position(countr_zero(targets))})) {
+				return true;
+			}
+		}
+
+		return false;
+	};
+
+	// Squares the king can't step onto. It's taken off the board first, or a slider checking it along a line would seem
+	// not to reach the square behind it.
+	Bitboard danger = attacks(them, occupied ^ king);
+	Bitboard kingTargets = STEPS.king[from] & ~own & ~danger;
+
+	Bitboard checkers = attackers(from, them, occupied);
+	if (popcount(checkers) > 1) {
+		return emitAll(from, kingTargets);
+	}
+
+	// with one checker, anything but the king has to take it or step in between
+	Bitboard evasions = checkers != 0 ? LINES.between[from][countr_zero(checkers)] | checkers : ~(Bitboard)0;
+
+	// An enemy slider that sees the king through our pieces alone pins the piece in between if there is only one; that
+	// piece may then only move along the line up to and onto the slider
+	Bitboard theirRooks = _pieces[them][ROOK_KIND] | _pieces[them][QUEEN_KIND];
+	Bitboard theirBishops = _pieces[them][BISHOP_KIND] | _pieces[them][QUEEN_KIND];
+	Bitboard pinned = 0, pinLines[64];
+
+	for (Bitboard snipers = (rookAttacks(from, enemy) & theirRooks) | (bishopAttacks(from, enemy) & theirBishops); snipers != 0;
+		 snipers &= snipers - 1) {
+		int sniper = countr_zero(snipers);
+		Bitboard blockers = LINES.between[from][sniper] & occupied;
+
+		if (popcount(blockers) == 1 && (blockers & own)) {
+			pinned |= blockers;
+			pinLines[countr_zero(blockers)] = LINES.between[from][sniper] | bit(sniper);
+		}
+	}
+
+	auto legal = [&evasions, &pinned, &pinLines](int from, Bitboard targets) {
+		targets &= evasions;
+		return pinned & bit(from) ? targets & pinLines[from] : targets;
+	};
+
+	int forward = us == 0 ? 1 : -1, startRank = us == 0 ? 1 : 6;
+
+	for (Bitboard pawns = _pieces[us][PAWN_KIND]; pawns != 0; pawns &= pawns - 1) {
+		int from = countr_zero(pawns), push = from + forward;
+		Bitboard targets = STEPS.pawn[us][from] & enemy;
+
+		// a pawn is never on the last rank, so the square ahead is always on the board
+		if (!(occupied & bit(push))) {
+			targets |= bit(push);
+
+			if ((from & 7) == startRank && !(occupied & bit(push + forward))) {
+				targets |= bit(push + forward);
+			}
+		}
+
+		if (emitAll(from, legal(from, targets))) {
+			return true;
+		}
+	}
+
+	if (_enPassant >= 0) {
+		int taken = (_enPassant & ~7) | ((_enPassant & 7) - forward);
+
+		// Pins and checks don't describe en passant, which empties two squares at once: the capture has to deal with any
+		// check, and with both pawns gone no slider may reach the king. That also catches the two pawns standing side by
+		// side between the king and a rook on their rank.
+		for (Bitboard capturers = STEPS.pawn[them][_enPassant] & _pieces[us][PAWN_KIND]; capturers != 0; capturers &= capturers - 1) {
+			int capturer = countr_zero(capturers);
+			Bitboard after = (occupied ^ bit(capturer) ^ bit(taken)) | bit(_enPassant);
+
+			if ((evasions & (bit(_enPassant) | bit(taken))) && !(rookAttacks(from, after) & theirRooks) && !(bishopAttacks(from, after) & theirBishops) &&
+				emitAll(capturer, bit(_enPassant))) {
+				return true;
+			}
+		}
+	}
+
+	for (Bitboard knights = _pieces[us][KNIGHT_KIND]; knights != 0; knights &= knights - 1) {
+		int from = countr_zero(knights);
+
+		if (emitAll(from, legal(from, STEPS.knight[from] & ~own))) {
+			return true;
+		}
+	}
+
+	for (Bitboard bishops = _pieces[us][BISHOP_KIND]; bishops != 0; bishops &= bishops - 1) {
+		int from = countr_zero(bishops);
+
+		if (emitAll(from, legal(from, bishopAttacks(from, occupied) & ~own))) {
+			return true;
+		}
+	}
+
+	for (Bitboard rooks = _pieces[us][ROOK_KIND]; rooks != 0; rooks &= rooks - 1) {
+		int from = countr_zero(rooks);
+
+		if (emitAll(from, legal(from, rookAttacks(from, occupied) & ~own))) {
+			return true;
+		}
+	}
+
+	for (Bitboard queens = _pieces[us][QUEEN_KIND]; queens != 0; queens &= queens - 1) {
+		int from = countr_zero(queens);
+
+		if (emitAll(from, legal(from, (rookAttacks(from, occupied) | bishopAttacks(from, occupied)) & ~own))) {
+			return true;
+		}
+	}
+
+	if (emitAll(from, kingTargets)) {
+		return true;
+	}
+
+	// Castling needs the squares between king and rook empty and the king not to start in, pass through or land in check
+	int rank = us == 0 ? 0 : 7, home = 4 * 8 + rank;
+	int kingside = us == 0 ? WHITE_KINGSIDE : BLACK_KINGSIDE, queenside = us == 0 ? WHITE_QUEENSIDE : BLACK_QUEENSIDE;
+
+	if (from == home && checkers == 0) {
+		Bitboard kingsidePath = bit(5 * 8 + rank) | bit(6 * 8 + rank), queensidePath = bit(2 * 8 + rank) | bit(3 * 8 + rank);
+
+		if ((_castling & kingside) && (_pieces[us][ROOK_KIND] & bit(7 * 8 + rank)) && !(occupied & kingsidePath) && !(danger & kingsidePath) &&
+			emitAll(home, bit(6 * 8 + rank))) {
+			return true;
+		}
+
+		if ((_castling & queenside) && (_pieces[us][ROOK_KIND] & bit(rank)) && !(occupied & (queensidePath | bit(1 * 8 + rank))) &&
+			!(danger & queensidePath) && emitAll(home, bit(2 * 8 + rank))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BitboardGame::play(int from, int to, int promoted) {
+	int us = _turn, them = 1 - us;
+	int moving = kind(from, us), captured = kind(to, them);
+	Bitboard change = bit(from) | bit(to);
+
+	_pieces[us][moving] ^= change;
+	_occupancy[us] ^= change;
+
+	if (captured >= 0) {
+		_pieces[them][captured] ^= bit(to);
+		_occupancy[them] ^= bit(to);
+	}
+
+	if (moving == PAWN_KIND && to == _enPassant) {
+		// en passant lands on an empty square, so nothing was taken above: the pawn taken stands on the destination's
+		// file but on the rank the mover left, and comes off from there
+		int taken = (to & ~7) | (from & 7);
+
+		_pieces[them][PAWN_KIND] ^= bit(taken);
+		_occupancy[them] ^= bit(taken);
+		captured = PAWN_KIND;
+	}
+
+	if (moving == KING_KIND && abs((to >> 3) - (from >> 3)) == 2) {
+		// a two-file king step is a castle, and one xor with both squares lifts the rook off its corner and sets it
+		// down on the square the king crossed
+		Bitboard rook = bit((to > from ? 7 * 8 : 0) + (from & 7)) | bit((from + to) / 2);
+
+		_pieces[us][ROOK_KIND] ^= rook;
+		_occupancy[us] ^= rook;
+	}
+
+	// a king or rook leaving its square, or a rook being taken on its corner, ends the castling that needs it
+	_castling &= ~(castlingUsing(from) | castlingUsing(to));
+
+	_enPassant = moving == PAWN_KIND && abs(to - from) == 2 ? (from + to) / 2 : -1;
+	_halfMoveClock = moving == PAWN_KIND || captured >= 0 ? 0 : _halfMoveClock + 1;
+
+	if (moving == PAWN_KIND && lastRank(to)) {
+		_pieces[us][PAWN_KIND] ^= bit(to);
+		_pieces[us][promoted] |= bit(to);
+	}
+
+	_fullMoves += us;
+	_turn = them;
+}
+
+Bitboard BitboardGame::attackers(int square, int by, Bitboard occupied) const {
+	const Bitboard* pieces = _pieces[by];
+
+	// a pawn of ours on square would capture exactly the squares from which their pawns attack it
+	return (STEPS.pawn[1 - by][square] & pieces[PAWN_KIND]) | (STEPS.knight[square] & pieces[KNIGHT_KIND]) | (STEPS.king[square] & pieces[KING_KIND]) |
+		   (bishopAttacks(square, occupied) & (pieces[BISHOP_KIND] | pieces[QUEEN_KIND])) |
+		   (rookAttacks(square, occupied) & (pieces[ROOK_KIND] | pieces[QUEEN_KIND]));
+}
+
+Bitboard BitboardGame::attacks(int by, Bitboard occupied) const {
+	const Bitboard* pieces = _pieces[by];
+	Bitboard out = 0;
+
+	for (Bitboard pawns = pieces[PAWN_KIND]; pawns != 0; pawns &= pawns - 1) {
+		out |= STEPS.pawn[by][countr_zero(pawns)];
+	}
+	for (Bitboard knights = pieces[KNIGHT_KIND]; knights != 0; knights &= knights - 1) {
+		out |= STEPS.knight[countr_zero(knights)];
+	}
+	for (Bitboard kings = pieces[KING_KIND]; kings != 0; kings &= kings - 1) {
+		out |= STEPS.king[countr_zero(kings)];
+	}
+	for (Bitboard diagonal = pieces[BISHOP_KIND] | pieces[QUEEN_KIND]; diagonal != 0; diagonal &= diagonal - 1) {
+		out |= bishopAttacks(countr_zero(diagonal), occupied);
+	}
+	for (Bitboard straight = pieces[ROOK_KIND] | pieces[QUEEN_KIND]; straight != 0; straight &= straight - 1) {
+		out |= rookAttacks(countr_zero(straight), occupied);
+	}
+
+	return out;
+}
+
+int BitboardGame::kind(int square, int player) const {
+	for (int kind = 0; kind < 6; kind++) {
+		if (_pieces[player][kind] & bit(square)) {
+			return kind;
+		}
+	}
+
+	return -1;
+}
\ No newline at end of file
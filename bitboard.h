@@ -0,0 +1,90 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chesstypes.h"
+
+// How sliding pieces' attacks are looked up. Both read a table built once at startup, indexed by which of the squares
+// that could block the piece are occupied: MAGIC hashes those bits with a multiply by a per-square magic number, PEXT
+// packs them with BMI2's pext, one instruction on Intel and on AMD from Zen 3 but microcoded and slow before that.
+enum class SliderLookups { MAGIC, PEXT };
+
+// Chess position kept in this repo as bitboards: one 64-bit set per player and piece type, plus each player's
+// occupancy. It is the Game the training code plays unless built with EXTERNAL_ENGINE (see game.h), answering the
+// engine's Game's calls except that a promotion is chosen along with its move, and exposes the sets themselves so evaluation can walk the pieces instead of probing 64
+// squares. Squares are numbered file * 8 + rank - 1 like Board and the genome, so bit i of a piece set lines up with
+// weight i of that piece's block; in this layout a step towards rank 8 is a shift by 1 and a step towards the h-file a
+// shift by 8.
+class BitboardGame {
+public:
+	typedef uint64_t Bitboard;
+
+	// the standard start position
+	BitboardGame();
+	// any position in Forsyth-Edwards notation; throws std::invalid_argument if it can't be read
+	BitboardGame(const std::string& fen);
+
+	std::vector<Move> getAvailableMoves() const;
+	// replaces out's contents with every legal move, so a buffer with room for them is reused without allocating
+	void getAvailableMoves(std::vector<Move>& out) const;
+	// whether the side to move has a legal move, stopping at the first one found
+	bool hasAnyLegalMove() const;
+
+	BitboardGame branch(const Move& move, PieceTypes promotion = PieceTypes::QUEEN) const;
+
+	// Plays move, a pawn it takes to the last rank becoming promotion in the same call; promotion is ignored for any
+	// other move. Throws std::invalid_argument if that pawn would become a pawn or a king.
+	void move(const Move& move, PieceTypes promotion = PieceTypes::QUEEN);
+
+	Players turn() const;
+	// pawns count 1, knights and bishops 3, rooks 5 and queens 9
+	int materiel(Players player) const;
+	std::string dumpFEN() const;
+
+	bool hasPiece(const Position& position) const;
+	Piece getPiece(const Position& position) const;
+
+	Bitboard pieces(Players player, PieceTypes type) const;
+	Bitboard occupancy(Players player) const;
+	Bitboard occupancy() const;
+
+	static int square(const Position& position);
+	static Position position(int square);
+
+	// squares a rook or bishop on square attacks, up to and including the first occupied square in each direction
+	static Bitboard rookAttacks(int square, Bitboard occupied);
+	static Bitboard bishopAttacks(int square, Bitboard occupied);
+
+	// Chooses the slider lookup for every game. Defaults to MAGIC, which is fast everywhere; PEXT is worth opting into on
+	// a BMI2 build for a CPU where pext is fast. Without BMI2 it runs through a portable bit loop, only useful for
+	// checking the tables.
+	static void setSliderLookup(SliderLookups lookup);
+	static SliderLookups sliderLookup();
+
+private:
+	// every legal move in turn, until emit returns false; returns whether it did
+	template <typename Emit>
+	bool generate(const Emit& emit) const;
+
+	// moves a piece without checking legality, a pawn reaching the last rank becoming a piece of kind promoted
+	void play(int from, int to, int promoted);
+
+	// the pieces of player by attacking square, and every square player by attacks, with occupied as the blockers
+	Bitboard attackers(int square, int by, Bitboard occupied) const;
+	Bitboard attacks(int by, Bitboard occupied) const;
+	int kind(int square, int player) const;
+
+	// indexed [player][kind], players white then black and kinds pawn, knight, bishop, rook, queen, king
+	Bitboard _pieces[2][6];
+	Bitboard _occupancy[2];
+
+	int _turn;
+	int _castling;	 // bits: white kingside, white queenside, black kingside, black queenside
+	int _enPassant;	 // square a pawn may capture onto en passant, or -1
+	uint _halfMoveClock, _fullMoves;
+};
+
+#endif
\ No newline at end of file
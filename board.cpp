@@ -0,0 +1,122 @@
+#include "board.h"
+
+#include <bit>
+#include <cstdlib>
+
+using namespace std;
+
+// Each (square, piece) gets a fixed pseudo-random key, derived on the spot with splitmix64 rather than looked up, and
+// an empty square contributes nothing
+static uint64_t zobrist(int square, const Board::Square& contents) {
+	if (!contents.occupied) {
+		return 0;
+	}
+
+	uint64_t z = ((uint64_t)square << 16 | (uint64_t)contents.type << 1 | (contents.player == Players::BLACK)) + 0x9e3779b97f4a7c15;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+	return z ^ (z >> 31);
+}
+
+#ifdef EXTERNAL_ENGINE
+Board::Board(const Game& game) : _hash(0) {
+	for (const Files file : FILES) {
+		for (const uint rank : RANKS) {
+			Square& square = _squares[index({.file = file, .rank = rank})];
+
+			if (game.hasPiece({.file = file, .rank = rank})) {
+				Piece piece = game.getPiece({.file = file, .rank = rank});
+
+				square = {.occupied = true, .type = piece.type(), .player = piece.player()};
+			} else {
+				square = {.occupied = false, .type = PieceTypes::PAWN, .player = Players::WHITE};
+			}
+
+			_hash ^= zobrist(index({.file = file, .rank = rank}), square);
+		}
+	}
+}
+#endif
+
+Board::Board(const BitboardGame& game) : _hash(0) {
+	for (Square& square : _squares) {
+		square = {.occupied = false, .type = PieceTypes::PAWN, .player = Players::WHITE};
+	}
+
+	for (const PieceTypes type : PIECE_TYPES) {
+		for (const Players player : {Players::WHITE, Players::BLACK}) {
+			for (BitboardGame::Bitboard pieces = game.pieces(player, type); pieces != 0; pieces &= pieces - 1) {
+				int square = countr_zero(pieces);
+
+				_squares[square] = {.occupied = true, .type = type, .player = player};
+				_hash ^= zobrist(square, _squares[square]);
+			}
+		}
+	}
+}
+
+Board::Delta Board::delta(const Candidate& candidate) const {
+	const Move& move = candidate.move;
+	Delta out;
+	out.count = 0;
+
+	auto change = [this, &out](int square, const Square& value) {
+		// a square is never touched twice by one move, so each change records the original contents
+		out.squares[out.count] = square;
+		out.before[out.count] = _squares[square];
+		out.after[out.count] = value;
+		out.count++;
+	};
+
+	int from = index(move.from), to = index(move.to);
+	Square moving = _squares[from], empty = {.occupied = false, .type = PieceTypes::PAWN, .player = Players::WHITE};
+
+	if (moving.type == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2) {
+		// castling: the rook jumps from its corner to the square the king passed over
+		bool kingside = move.to.file > move.from.file;
+		int rookFrom = index({.file = kingside ? Files::H : Files::A, .rank = move.from.rank});
+		int rookTo = index({.file = (Files)((move.from.file + move.to.file) / 2), .rank = move.from.rank});
+
+		change(rookTo, _squares[rookFrom]);
+		change(rookFrom, empty);
+	} else if (moving.type == PieceTypes::PAWN && move.from.file != move.to.file && !_squares[to].occupied) {
+		// en passant: the captured pawn sits beside the moving one, not on the destination
+		change(index({.file = move.to.file, .rank = move.from.rank}), empty);
+	}
+
+	Square placed = moving;
+	if (candidate.promotion != PieceTypes::PAWN) {
+		placed.type = candidate.promotion;
+	}
+
+	change(to, placed);
+	change(from, empty);
+
+	return out;
+}
+
+bool Board::promotes(const Move& move) const {
+	const Square& moving = _squares[index(move.from)];
+
+	return moving.occupied && moving.type == PieceTypes::PAWN && (move.to.rank == 1 || move.to.rank == 8);
+}
+
+void Board::expand(const vector<Move>& moves, vector<Candidate>& out) const {
+	out.clear();
+
+	for (const Move& move : moves) {
+		if (promotes(move)) {
+			for (PieceTypes piece = PieceTypes::KNIGHT; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
+				out.push_back({.move = move, .promotion = piece});
+			}
+		} else {
+			out.push_back({.move = move});
+		}
+	}
+}
+
+const Board::Square& Board::at(int square) const { return _squares[square]; }
+
+uint64_t Board::hash(Players toMove) const { return toMove == Players::BLACK ? _hash ^ 0xd6e8feb86659fd93 : _hash; }
+
+int Board::index(const Position& position) { return position.file * 8 + position.rank - 1; }
\ No newline at end of file
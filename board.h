@@ -0,0 +1,64 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <vector>
+
+#include "bitboard.h"
+#include "game.h"
+
+// A move as the game driver chooses it. A pawn reaching the last rank makes one candidate per piece it can become, so
+// the promotion is scored along with everything else; any other move is a single candidate with promotion left PAWN.
+struct Candidate {
+	Move move;
+	PieceTypes promotion = PieceTypes::PAWN;
+};
+
+// Mailbox snapshot of a Game's pieces, indexed file * 8 + rank - 1 like the genome. A candidate is scored from the few
+// squares its delta touches, so scoring one doesn't need a copy of the game the way Game::branch does.
+class Board {
+public:
+	struct Square {
+		bool occupied;
+		PieceTypes type;
+		Players player;
+	};
+
+	// the squares a move touches with their contents before and after
+	struct Delta {
+		int squares[4];
+		Square before[4];
+		Square after[4];
+		int count;
+	};
+
+#ifdef EXTERNAL_ENGINE
+	// the engine's Game, read square by square
+	Board(const Game& game);
+#endif
+	// filled from the piece sets directly rather than asking square by square
+	Board(const BitboardGame& game);
+
+	// What playing candidate would change: including the rook hop of a castle, the pawn taken en passant and the piece a
+	// pawn promotes to
+	Delta delta(const Candidate& candidate) const;
+
+	// whether move takes a pawn to the last rank
+	bool promotes(const Move& move) const;
+	// replaces out with the candidates for moves, in order, a promoting move expanding to knight, bishop, rook and queen
+	void expand(const std::vector<Move>& moves, std::vector<Candidate>& out) const;
+
+	const Square& at(int square) const;
+
+	// Zobrist hash of the pieces and the side to move, computed when the board is filled. Castling and en passant rights
+	// aren't tracked by the board, so equal hashes can still differ in those.
+	uint64_t hash(Players toMove) const;
+
+	static int index(const Position& position);
+
+private:
+	Square _squares[64];
+	uint64_t _hash;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Fixed-capacity map that evicts the least recently used entry once full. Not thread safe; callers are expected to
+// consult it from a single thread around parallel sections.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LRUCache {
+public:
+	LRUCache(std::size_t capacity) : _capacity(capacity) {}
+
+	// copies the cached value into out and marks it as recently used, returns false on a miss
+	bool get(const Key& key, Value& out) {
+		auto it = _index.find(key);
+
+		if (it == _index.end()) {
+			return false;
+		}
+
+		_entries.splice(_entries.begin(), _entries, it->second);
+		out = it->second->second;
+
+		return true;
+	}
+
+	void put(const Key& key, const Value& value) {
+		if (_capacity == 0) {
+			return;
+		}
+
+		auto it = _index.find(key);
+
+		if (it != _index.end()) {
+			it->second->second = value;
+			_entries.splice(_entries.begin(), _entries, it->second);
+			return;
+		}
+
+		if (_entries.size() >= _capacity) {
+			_index.erase(_entries.back().first);
+			_entries.pop_back();
+		}
+
+		_entries.emplace_front(key, value);
+		_index[key] = _entries.begin();
+	}
+
+	std::size_t size() const { return _entries.size(); }
+
+private:
+	std::size_t _capacity;
+
+	std::list<std::pair<Key, Value>> _entries;	// most recently used first
+	std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash> _index;
+};
+
+#endif
\ No newline at end of file
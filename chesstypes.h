@@ -0,0 +1,46 @@
+#ifndef CHESSTYPES_H
+#define CHESSTYPES_H
+
+// The chess value types shared by the training code and BitboardGame: sides, piece types, squares, moves and pieces.
+// They are kept here, matching the engine's own, so the tree builds without the engine; built with EXTERNAL_ENGINE,
+// the engine's definitions are used instead.
+#ifdef EXTERNAL_ENGINE
+#include "engine/chess.h"
+#else
+
+#include <sys/types.h>
+
+enum Files { A, B, C, D, E, F, G, H };
+enum PieceTypes { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+enum class Players { WHITE, BLACK };
+
+inline const PieceTypes PIECE_TYPES[6] = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
+inline const Files FILES[8] = {A, B, C, D, E, F, G, H};
+inline const uint RANKS[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+// a square, rank counting from 1 on white's side
+struct Position {
+	Files file;
+	uint rank;
+};
+
+struct Move {
+	Position from;
+	Position to;
+};
+
+class Piece {
+public:
+	Piece(PieceTypes type, Players player) : _type(type), _player(player) {}
+
+	PieceTypes type() const { return _type; }
+	Players player() const { return _player; }
+
+private:
+	PieceTypes _type;
+	Players _player;
+};
+
+#endif
+
+#endif
\ No newline at end of file
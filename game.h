@@ -0,0 +1,44 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stdexcept>
+#include <vector>
+
+// The Game the training code plays. By default it is BitboardGame, kept in this repo; built with EXTERNAL_ENGINE it is
+// the engine's own Game from engine/chess.h, which answers the same calls.
+#ifdef EXTERNAL_ENGINE
+#include "engine/chess.h"
+#else
+#include "bitboard.h"
+
+typedef BitboardGame Game;
+#endif
+
+// Replaces out's contents with game's legal moves. BitboardGame fills out in place, so a buffer reserved once is reused
+// without allocating; the engine's Game can only return a new list, which is moved in.
+inline void availableMoves(const Game& game, std::vector<Move>& out) {
+#ifdef EXTERNAL_ENGINE
+	out = game.getAvailableMoves();
+#else
+	game.getAvailableMoves(out);
+#endif
+}
+
+// Plays move on game, a pawn it takes to the last rank becoming promotion. BitboardGame does both in one call; the
+// engine's Game only reports the promotion once the pawn has moved, and takes the piece as a second call. Either way a
+// pawn can't promote to a pawn: BitboardGame throws std::invalid_argument for it, and so does this for the engine.
+inline void playMove(Game& game, const Move& move, PieceTypes promotion) {
+#ifdef EXTERNAL_ENGINE
+	if (game.move(move)) {
+		if (promotion == PieceTypes::PAWN) {
+			throw std::invalid_argument("Pawns can only promote to a knight, bishop, rook or queen");
+		}
+
+		game.promote(move.to, promotion);
+	}
+#else
+	game.move(move, promotion);
+#endif
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "kernels.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+#if defined(__AVX2__)
+
+double kernels::dot(const double* weights, const int16_t* features, size_t count) {
+	__m256d sum = _mm256_setzero_pd();
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128i mask = _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*)(features + i)));
+		sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_load_pd(weights + i), _mm256_cvtepi32_pd(mask)));
+	}
+
+	__m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+	return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+float kernels::dot(const float* weights, const int16_t* features, size_t count) {
+	__m256 sum = _mm256_setzero_ps();
+
+	for (size_t i = 0; i < count; i += 8) {
+		__m256i mask = _mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(features + i)));
+		sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_load_ps(weights + i), _mm256_cvtepi32_ps(mask)));
+	}
+
+	__m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+	half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+	return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
+
+int32_t kernels::dot(const int16_t* weights, const int16_t* features, size_t count) {
+	__m256i sum = _mm256_setzero_si256();
+
+	// madd multiplies 16 pairs of int16 and adds neighbouring products into 8 int32 lanes
+	for (size_t i = 0; i < count; i += 16) {
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_load_si256((const __m256i*)(weights + i)), _mm256_load_si256((const __m256i*)(features + i))));
+	}
+
+	__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+	half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(half);
+}
+
+double kernels::combine(const double* partials, size_t stride) {
+	// the two 128-bit halves first, then the two doubles of their sum
+	return (partials[0] + partials[2 * stride]) + (partials[stride] + partials[3 * stride]);
+}
+
+float kernels::combine(const float* partials, size_t stride) {
+	float half[4];
+	for (size_t k = 0; k < 4; k++) {
+		half[k] = partials[k * stride] + partials[(k + 4) * stride];
+	}
+
+	return (half[0] + half[2]) + (half[1] + half[3]);
+}
+
+#elif defined(__SSE2__)
+
+double kernels::dot(const double* weights, const int16_t* features, size_t count) {
+	__m128d sum = _mm_setzero_pd();
+
+	for (size_t i = 0; i < count; i += 2) {
+		sum = _mm_add_pd(sum, _mm_mul_pd(_mm_load_pd(weights + i), _mm_set_pd(features[i + 1], features[i])));
+	}
+
+	return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+
+float kernels::dot(const float* weights, const int16_t* features, size_t count) {
+	__m128 sum = _mm_setzero_ps();
+
+	for (size_t i = 0; i < count; i += 4) {
+		// sign-extend four int16 by pairing them with their own sign bits
+		__m128i packed = _mm_loadl_epi64((const __m128i*)(features + i));
+		__m128i mask = _mm_unpacklo_epi16(packed, _mm_srai_epi16(packed, 15));
+
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(weights + i), _mm_cvtepi32_ps(mask)));
+	}
+
+	sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+	return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+}
+
+int32_t kernels::dot(const int16_t* weights, const int16_t* features, size_t count) {
+	__m128i sum = _mm_setzero_si128();
+
+	for (size_t i = 0; i < count; i += 8) {
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_load_si128((const __m128i*)(weights + i)), _mm_load_si128((const __m128i*)(features + i))));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+}
+
+double kernels::combine(const double* partials, size_t stride) {
+	return partials[0] + partials[stride];
+}
+
+float kernels::combine(const float* partials, size_t stride) {
+	return (partials[0] + partials[2 * stride]) + (partials[stride] + partials[3 * stride]);
+}
+
+#else
+
+double kernels::dot(const double* weights, const int16_t* features, size_t count) {
+	double sum = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		sum += weights[i] * features[i];
+	}
+
+	return sum;
+}
+
+float kernels::dot(const float* weights, const int16_t* features, size_t count) {
+	float sum = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		sum += weights[i] * features[i];
+	}
+
+	return sum;
+}
+
+int32_t kernels::dot(const int16_t* weights, const int16_t* features, size_t count) {
+	int32_t sum = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		sum += weights[i] * features[i];
+	}
+
+	return sum;
+}
+
+double kernels::combine(const double* partials, size_t) {
+	return partials[0];
+}
+
+float kernels::combine(const float* partials, size_t) {
+	return partials[0];
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+void kernels::gatherAdd(const double* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						double* out) {
+	for (size_t m = 0; m < count; m += 4) {
+		__m256d sum = _mm256_loadu_pd(out + m);
+
+		for (size_t t = 0; t < terms; t++) {
+			__m128i index = _mm_loadu_si128((const __m128i*)(indices + t * stride + m));
+			__m256d sign = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(signs + t * stride + m)));
+
+			// the masked gathers, with every lane enabled, start from a defined zero rather than an undefined register
+			__m256d weight = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), weights, index, _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+
+			sum = _mm256_add_pd(sum, _mm256_mul_pd(sign, weight));
+		}
+
+		_mm256_storeu_pd(out + m, sum);
+	}
+}
+
+void kernels::gatherAdd(const float* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						float* out) {
+	for (size_t m = 0; m < count; m += 8) {
+		__m256 sum = _mm256_loadu_ps(out + m);
+
+		for (size_t t = 0; t < terms; t++) {
+			__m256i index = _mm256_loadu_si256((const __m256i*)(indices + t * stride + m));
+			__m256 sign = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(signs + t * stride + m)));
+
+			__m256 weight = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), weights, index, _mm256_castsi256_ps(_mm256_set1_epi32(-1)), 4);
+
+			sum = _mm256_add_ps(sum, _mm256_mul_ps(sign, weight));
+		}
+
+		_mm256_storeu_ps(out + m, sum);
+	}
+}
+
+void kernels::gatherAdd(const int16_t* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						int32_t* out) {
+	for (size_t m = 0; m < count; m += 8) {
+		__m256i sum = _mm256_loadu_si256((const __m256i*)(out + m));
+
+		for (size_t t = 0; t < terms; t++) {
+			__m256i index = _mm256_loadu_si256((const __m256i*)(indices + t * stride + m));
+			__m256i sign = _mm256_loadu_si256((const __m256i*)(signs + t * stride + m));
+
+			// there is no 16-bit gather, so gather the 32 bits starting at each weight and sign-extend the low half
+			__m256i halves = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)weights, index, _mm256_set1_epi32(-1), 2);
+			__m256i weight = _mm256_srai_epi32(_mm256_slli_epi32(halves, 16), 16);
+
+			sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(sign, weight));
+		}
+
+		_mm256_storeu_si256((__m256i*)(out + m), sum);
+	}
+}
+
+#else
+
+void kernels::gatherAdd(const double* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						double* out) {
+	for (size_t t = 0; t < terms; t++) {
+		for (size_t m = 0; m < count; m++) {
+			out[m] += signs[t * stride + m] * weights[indices[t * stride + m]];
+		}
+	}
+}
+
+void kernels::gatherAdd(const float* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						float* out) {
+	for (size_t t = 0; t < terms; t++) {
+		for (size_t m = 0; m < count; m++) {
+			out[m] += signs[t * stride + m] * weights[indices[t * stride + m]];
+		}
+	}
+}
+
+void kernels::gatherAdd(const int16_t* weights, const int32_t* indices, const int32_t* signs, size_t terms, size_t stride, size_t count,
+						int32_t* out) {
+	for (size_t t = 0; t < terms; t++) {
+		for (size_t m = 0; m < count; m++) {
+			out[m] += signs[t * stride + m] * weights[indices[t * stride + m]];
+		}
+	}
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+void kernels::accumulate(const double* row, int sign, size_t count, double* out) {
+	// multiplying by +-1 is exact, so this rounds like the add or subtract it stands for
+	__m256d factor = _mm256_set1_pd(sign);
+
+	for (size_t i = 0; i < count; i += 4) {
+		_mm256_store_pd(out + i, _mm256_add_pd(_mm256_load_pd(out + i), _mm256_mul_pd(factor, _mm256_load_pd(row + i))));
+	}
+}
+
+void kernels::accumulate(const float* row, int sign, size_t count, float* out) {
+	__m256 factor = _mm256_set1_ps(sign);
+
+	for (size_t i = 0; i < count; i += 8) {
+		_mm256_store_ps(out + i, _mm256_add_ps(_mm256_load_ps(out + i), _mm256_mul_ps(factor, _mm256_load_ps(row + i))));
+	}
+}
+
+void kernels::accumulate(const int16_t* row, int sign, size_t count, int32_t* out) {
+	__m256i factor = _mm256_set1_epi32(sign);
+
+	for (size_t i = 0; i < count; i += 8) {
+		__m256i weight = _mm256_cvtepi16_epi32(_mm_load_si128((const __m128i*)(row + i)));
+		_mm256_store_si256((__m256i*)(out + i), _mm256_add_epi32(_mm256_load_si256((const __m256i*)(out + i)), _mm256_sign_epi32(weight, factor)));
+	}
+}
+
+#elif defined(__SSE2__)
+
+void kernels::accumulate(const double* row, int sign, size_t count, double* out) {
+	__m128d factor = _mm_set1_pd(sign);
+
+	for (size_t i = 0; i < count; i += 2) {
+		_mm_store_pd(out + i, _mm_add_pd(_mm_load_pd(out + i), _mm_mul_pd(factor, _mm_load_pd(row + i))));
+	}
+}
+
+void kernels::accumulate(const float* row, int sign, size_t count, float* out) {
+	__m128 factor = _mm_set1_ps(sign);
+
+	for (size_t i = 0; i < count; i += 4) {
+		_mm_store_ps(out + i, _mm_add_ps(_mm_load_ps(out + i), _mm_mul_ps(factor, _mm_load_ps(row + i))));
+	}
+}
+
+void kernels::accumulate(const int16_t* row, int sign, size_t count, int32_t* out) {
+	// negating is (x ^ -1) - -1, and a no-op with 0 in place of -1
+	__m128i negate = _mm_set1_epi32(sign < 0 ? -1 : 0);
+
+	for (size_t i = 0; i < count; i += 4) {
+		__m128i packed = _mm_loadl_epi64((const __m128i*)(row + i));
+		__m128i weight = _mm_unpacklo_epi16(packed, _mm_srai_epi16(packed, 15));
+
+		weight = _mm_sub_epi32(_mm_xor_si128(weight, negate), negate);
+		_mm_store_si128((__m128i*)(out + i), _mm_add_epi32(_mm_load_si128((const __m128i*)(out + i)), weight));
+	}
+}
+
+#else
+
+void kernels::accumulate(const double* row, int sign, size_t count, double* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] += sign * row[i];
+	}
+}
+
+void kernels::accumulate(const float* row, int sign, size_t count, float* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] += sign * row[i];
+	}
+}
+
+void kernels::accumulate(const int16_t* row, int sign, size_t count, int32_t* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] += sign * row[i];
+	}
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Dot products of a genome's weights against a one-hot feature vector (+1 for the perspective's pieces, -1 for the
+// opponent's, 0 elsewhere), one per genome scalar type. count must be a multiple of 16 and both arrays aligned to 32
+// bytes. AVX2 is used when the translation unit is built with it, then SSE2, then plain loops.
+namespace kernels {
+double dot(const double* weights, const int16_t* features, std::size_t count);
+float dot(const float* weights, const int16_t* features, std::size_t count);
+int32_t dot(const int16_t* weights, const int16_t* features, std::size_t count);
+
+// The order dot adds in, for reproducing its floating-point results from sums kept elsewhere: feature i goes into
+// partial sum i % DOUBLE_LANES (or FLOAT_LANES) in index order, starting from 0, and combine adds up the partial sums,
+// stride apart, the way dot does at the end. The int16 dot is exact, so its order doesn't matter.
+#if defined(__AVX2__)
+inline constexpr std::size_t DOUBLE_LANES = 4, FLOAT_LANES = 8;
+#elif defined(__SSE2__)
+inline constexpr std::size_t DOUBLE_LANES = 2, FLOAT_LANES = 4;
+#else
+inline constexpr std::size_t DOUBLE_LANES = 1, FLOAT_LANES = 1;
+#endif
+double combine(const double* partials, std::size_t stride);
+float combine(const float* partials, std::size_t stride);
+
+// Batched sparse updates: for each column m < count, out[m] += signs[t * stride + m] * weights[indices[t * stride + m]]
+// over the rows t < terms, in row order. Columns are candidates and rows the handful of features each one changes, so
+// AVX2 gathers advance 4 (double) or 8 (float, int16) candidates per instruction. count must be a multiple of 8 and the
+// int16 weights readable for two bytes past their end, as they are gathered 32 bits at a time.
+void gatherAdd(const double* weights, const int32_t* indices, const int32_t* signs, std::size_t terms, std::size_t stride, std::size_t count,
+			   double* out);
+void gatherAdd(const float* weights, const int32_t* indices, const int32_t* signs, std::size_t terms, std::size_t stride, std::size_t count,
+			   float* out);
+void gatherAdd(const int16_t* weights, const int32_t* indices, const int32_t* signs, std::size_t terms, std::size_t stride, std::size_t count,
+			   int32_t* out);
+
+// Dense row updates for population-major weights: out[i] += sign * row[i] for i < count, sign being +1 or -1. Each row
+// holds one feature's weight in every individual, so one call advances 4 (double) or 8 (float, and int16 widened to
+// int32) individuals per instruction. count must be a multiple of 16 and both arrays aligned to 32 bytes.
+void accumulate(const double* row, int sign, std::size_t count, double* out);
+void accumulate(const float* row, int sign, std::size_t count, float* out);
+void accumulate(const int16_t* row, int sign, std::size_t count, int32_t* out);
+}  // namespace kernels
+
+#endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "movecache.h"
+
+#include <algorithm>
+
+using namespace std;
+
+MoveCache::MoveCache(const vector<uint64_t>& genomes) : _lookups(new atomic<size_t>[MAX_DEPTH + 1]), _hits(new atomic<size_t>[MAX_DEPTH + 1]) {
+	// every table exists before play starts, so _tables itself is only ever read from the workers
+	for (uint64_t genome : genomes) {
+		if (_tables.find(genome) == _tables.end()) {
+			_tables[genome] = make_unique<Table>();
+		}
+	}
+
+	for (uint depth = 0; depth <= MAX_DEPTH; depth++) {
+		_lookups[depth] = 0;
+		_hits[depth] = 0;
+	}
+}
+
+bool MoveCache::get(uint64_t genome, uint64_t position, uint halfMove, Candidate& out) {
+	auto table = _tables.find(genome);
+	if (table == _tables.end()) {
+		return false;
+	}
+
+	bool found = false;
+	{
+		lock_guard guard(table->second->lock);
+
+		auto entry = table->second->choices.find(position);
+		if (entry != table->second->choices.end()) {
+			out = entry->second;
+			found = true;
+		}
+	}
+
+	uint depth = min(halfMove, MAX_DEPTH);
+	_lookups[depth].fetch_add(1, memory_order_relaxed);
+	if (found) {
+		_hits[depth].fetch_add(1, memory_order_relaxed);
+	}
+
+	return found;
+}
+
+void MoveCache::put(uint64_t genome, uint64_t position, const Candidate& choice) {
+	auto table = _tables.find(genome);
+	if (table == _tables.end()) {
+		return;
+	}
+
+	lock_guard guard(table->second->lock);
+	table->second->choices.insert({position, choice});
+}
+
+size_t MoveCache::lookups(uint halfMove) const {
+	return _lookups[min(halfMove, MAX_DEPTH)].load(memory_order_relaxed);
+}
+
+size_t MoveCache::hits(uint halfMove) const {
+	return _hits[min(halfMove, MAX_DEPTH)].load(memory_order_relaxed);
+}
\ No newline at end of file
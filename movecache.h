@@ -0,0 +1,48 @@
+#ifndef MOVECACHE_H
+#define MOVECACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "board.h"
+#include "chesstypes.h"
+
+// Remembers, for each genome, the move it chose in every position it has reached this generation. Play is
+// deterministic, so a genome that meets a position again (against another opponent, or from another opening) would
+// choose the same move and skip scoring its candidates. One table per genome, each with its own lock, so games of
+// different individuals never contend; games of the same individual on several workers share what they find.
+class MoveCache {
+public:
+	// one table per distinct genome content hash
+	MoveCache(const std::vector<uint64_t>& genomes);
+	MoveCache(const MoveCache& other) = delete;
+
+	// position is a key for everything the choice depends on besides the genome; halfMove is only used for the counts
+	bool get(uint64_t genome, uint64_t position, uint halfMove, Candidate& out);
+	void put(uint64_t genome, uint64_t position, const Candidate& choice);
+
+	// lookups and hits at each half-move of a game; everything from MAX_DEPTH on is counted in the last slot
+	std::size_t lookups(uint halfMove) const;
+	std::size_t hits(uint halfMove) const;
+
+	MoveCache& operator=(const MoveCache& other) = delete;
+
+	static constexpr uint MAX_DEPTH = 200;
+
+private:
+	struct alignas(64) Table {
+		std::mutex lock;
+		std::unordered_map<uint64_t, Candidate> choices;
+	};
+
+	std::unordered_map<uint64_t, std::unique_ptr<Table>> _tables;
+
+	std::unique_ptr<std::atomic<std::size_t>[]> _lookups;
+	std::unique_ptr<std::atomic<std::size_t>[]> _hits;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "pool.h"
+
+using namespace std;
+
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t size) : _queued(0), _pending(0), _next(0), _stopping(false) {
+	if (size == 0) {
+		size = max(thread::hardware_concurrency(), 1u);
+	}
+
+	_queues = make_unique<WorkQueue[]>(size);
+
+	for (size_t i = 0; i < size; i++) {
+		_workers.push_back(thread(&ThreadPool::work, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	unique_lock guard(_lock);
+	_stopping = true;
+	guard.unlock();
+
+	_available.notify_all();
+
+	for (thread& worker : _workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(function<void()> task) {
+	size_t index = currentPool == this ? currentWorker : _next++ % _workers.size();
+
+	_pending++;
+
+	unique_lock queueGuard(_queues[index].lock);
+	_queues[index].tasks.push_back(std::move(task));
+	queueGuard.unlock();
+
+	_queued++;
+
+	// taking the lock orders the increment above before any sleeping worker re-checks its predicate
+	unique_lock guard(_lock);
+	guard.unlock();
+
+	_available.notify_one();
+}
+
+void ThreadPool::wait() {
+	unique_lock guard(_lock);
+
+	_idle.wait(guard, [this]() { return _pending == 0; });
+}
+
+bool ThreadPool::waitFor(chrono::milliseconds timeout) {
+	unique_lock guard(_lock);
+
+	return _idle.wait_for(guard, timeout, [this]() { return _pending == 0; });
+}
+
+size_t ThreadPool::size() const { return _workers.size(); }
+
+size_t ThreadPool::workerIndex() { return currentWorker; }
+
+chrono::nanoseconds ThreadPool::busyTime() const {
+	long long total = 0;
+
+	for (size_t i = 0; i < _workers.size(); i++) {
+		total += _queues[i].busy;
+	}
+
+	return chrono::nanoseconds(total);
+}
+
+void ThreadPool::work(size_t index) {
+	currentPool = this;
+	currentWorker = index;
+
+	while (true) {
+		function<void()> task;
+
+		if (pop(index, task) || steal(index, task)) {
+			auto start = chrono::steady_clock::now();
+			task();
+			_queues[index].busy += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+
+			if (--_pending == 0) {
+				lock_guard guard(_lock);
+				_idle.notify_all();
+			}
+
+			continue;
+		}
+
+		unique_lock guard(_lock);
+		_available.wait(guard, [this]() { return _stopping || _queued > 0; });
+
+		if (_stopping && _queued == 0) {
+			return;
+		}
+	}
+}
+
+// owners take from the front of their own deque...
+bool ThreadPool::pop(size_t index, function<void()>& task) {
+	lock_guard guard(_queues[index].lock);
+
+	if (_queues[index].tasks.empty()) {
+		return false;
+	}
+
+	task = std::move(_queues[index].tasks.front());
+	_queues[index].tasks.pop_front();
+	_queued--;
+
+	return true;
+}
+
+// ...and thieves from the back of everyone else's, so the two rarely meet on the same task
+bool ThreadPool::steal(size_t index, function<void()>& task) {
+	for (size_t offset = 1; offset < _workers.size(); offset++) {
+		WorkQueue& victim = _queues[(index + offset) % _workers.size()];
+		lock_guard guard(victim.lock);
+
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.back());
+			victim.tasks.pop_back();
+			_queued--;
+
+			return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
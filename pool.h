@@ -0,0 +1,68 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size set of worker threads that live for the whole run. Each worker owns a deque of tasks and steals from the
+// other workers' deques once its own runs dry, so uneven task lengths don't leave threads idle at the end of a batch.
+class ThreadPool {
+public:
+	// size 0 means one worker per hardware thread
+	ThreadPool(std::size_t size = 0);
+	ThreadPool(const ThreadPool& other) = delete;
+
+	ThreadPool& operator=(const ThreadPool& other) = delete;
+
+	~ThreadPool();
+
+	// tasks submitted from a worker go to that worker's deque, others are dealt round-robin
+	void submit(std::function<void()> task);
+
+	// blocks until every submitted task has finished
+	void wait();
+	// as above, but gives up after timeout; returns whether the pool is idle
+	bool waitFor(std::chrono::milliseconds timeout);
+
+	std::size_t size() const;
+
+	// index of the calling worker in [0, size()), only meaningful from inside a task
+	static std::size_t workerIndex();
+
+	// total time workers have spent running tasks since construction
+	std::chrono::nanoseconds busyTime() const;
+
+private:
+	struct alignas(64) WorkQueue {
+		std::mutex lock;
+		std::deque<std::function<void()>> tasks;
+		std::atomic<long long> busy{0};	 // nanoseconds
+	};
+
+	void work(std::size_t index);
+
+	bool pop(std::size_t index, std::function<void()>& task);
+	bool steal(std::size_t index, std::function<void()>& task);
+
+	std::vector<std::thread> _workers;
+	std::unique_ptr<WorkQueue[]> _queues;
+
+	std::atomic<std::size_t> _queued;
+	std::atomic<std::size_t> _pending;
+	std::atomic<std::size_t> _next;
+
+	std::mutex _lock;
+	std::condition_variable _available;
+	std::condition_variable _idle;
+
+	bool _stopping;
+};
+
+#endif
\ No newline at end of file
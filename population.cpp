@@ -0,0 +1,183 @@
+#include "population.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <utility>
+
+#include "kernels.h"
+
+using namespace std;
+
+PopulationWeights::PopulationWeights(const vector<Individual>& population) : _size(population.size()), _stride((population.size() + 15) / 16 * 16) {
+	size_t rows = Individual::WEIGHTS * _stride;
+
+	// the tail padding lets kernels::gatherAdd read the last int16 weight 32 bits at a time
+	_weights = static_cast<double*>(::operator new[](rows * (sizeof(double) + sizeof(float) + sizeof(int16_t)) + Individual::WEIGHTS_ALIGNMENT,
+													  align_val_t(Individual::WEIGHTS_ALIGNMENT)));
+	_floatWeights = reinterpret_cast<float*>(_weights + rows);
+	_fixedWeights = reinterpret_cast<int16_t*>(_floatWeights + rows);
+
+	// the padding columns past the last individual stay 0, so they only ever accumulate 0
+	fill(_weights, _weights + rows, 0.0);
+	fill(_floatWeights, _floatWeights + rows, 0.0f);
+	fill(_fixedWeights, _fixedWeights + rows, 0);
+
+	for (size_t i = 0; i < _size; i++) {
+		for (size_t feature = 0; feature < Individual::WEIGHTS; feature++) {
+			_weights[feature * _stride + i] = population[i].weights[feature];
+			_floatWeights[feature * _stride + i] = population[i].floatWeights[feature];
+			_fixedWeights[feature * _stride + i] = population[i].fixedWeights[feature];
+		}
+	}
+}
+
+void PopulationWeights::evaluatePosition(const Board& board, Players perspective, double* scores, Precisions precision) const {
+	// individuals are scored a chunk at a time so the partial sums fit on the stack; CHUNK is a multiple of 16 like _stride
+	static constexpr size_t CHUNK = 256;
+	alignas(32) double doubleSums[kernels::DOUBLE_LANES * CHUNK];
+	alignas(32) float floatSums[kernels::FLOAT_LANES * CHUNK];
+	alignas(32) int32_t fixedSums[CHUNK];
+
+	// the features are the same for every chunk, so the board is read once, into (row, sign) pairs in row order
+	pair<int, int> terms[64];
+	int count = 0;
+
+	for (int i = 0; i < 64; i++) {
+		const Board::Square& square = board.at(i);
+
+		if (square.occupied) {
+			terms[count++] = {Individual::pieceIndex(square.type) * 64 + i, square.player == perspective ? 1 : -1};
+		}
+	}
+
+	sort(terms, terms + count);
+
+	// Each row is added into the partial sums of the lane kernels::dot would add that feature in, lanes CHUNK apart, and
+	// finish turns one individual's partial sums into its score, so scores match Individual's bit for bit.
+	auto score = [this, &terms, count, scores](auto* sums, const auto* weights, size_t lanes, auto finish) {
+		for (size_t first = 0; first < _stride; first += CHUNK) {
+			size_t width = min(CHUNK, _stride - first);
+
+			fill(sums, sums + lanes * CHUNK, 0);
+			for (int t = 0; t < count; t++) {
+				auto [row, sign] = terms[t];
+				kernels::accumulate(weights + row * _stride + first, sign, width, sums + row % lanes * CHUNK);
+			}
+
+			for (size_t i = 0; i < min(width, _size - first); i++) {
+				scores[first + i] = finish(sums + i);
+			}
+		}
+	};
+
+	switch (precision) {
+		case Precisions::FLOAT:
+			score(floatSums, _floatWeights, kernels::FLOAT_LANES, [](const float* sums) { return kernels::combine(sums, CHUNK); });
+			break;
+		case Precisions::FIXED16:
+			score(fixedSums, _fixedWeights, 1, [](const int32_t* sums) { return *sums / Individual::FIXED_SCALE; });
+			break;
+		case Precisions::DOUBLE:
+		default:
+			score(doubleSums, _weights, kernels::DOUBLE_LANES, [](const double* sums) { return kernels::combine(sums, CHUNK); });
+			break;
+	}
+}
+
+void PopulationWeights::evaluateMoves(const vector<MoveRequest>& requests, Precisions precision) const {
+	static constexpr size_t CHUNK = 256, TERMS = Individual::MOVE_TERMS;
+	alignas(32) int32_t indices[TERMS][CHUNK], signs[TERMS][CHUNK];
+	alignas(32) double doubleScores[CHUNK];
+	alignas(32) float floatScores[CHUNK];
+	alignas(32) int32_t fixedScores[CHUNK];
+	double bases[CHUNK];
+	double* targets[CHUNK];
+
+	// candidates from any of the requests fill the columns in turn, and a full chunk is scored and written back
+	size_t count = 0, terms = 0;
+	auto flush = [&]() {
+		size_t padded = (count + 7) / 8 * 8;
+		for (size_t m = count; m < padded; m++) {
+			bases[m] = 0;
+			for (size_t t = 0; t < terms; t++) {
+				indices[t][m] = 0;
+				signs[t][m] = 0;
+			}
+		}
+
+		// each column starts from its base in the evaluation's own type and adds its terms in order, as
+		// Individual::evaluateMoves does, so the two agree exactly
+		switch (precision) {
+			case Precisions::FLOAT:
+				transform(bases, bases + padded, floatScores, [](double base) { return (float)base; });
+				kernels::gatherAdd(_floatWeights, indices[0], signs[0], terms, CHUNK, padded, floatScores);
+				for (size_t m = 0; m < count; m++) {
+					*targets[m] = floatScores[m];
+				}
+				break;
+			case Precisions::FIXED16:
+				transform(bases, bases + padded, fixedScores, [](double base) { return (int32_t)lround(base * Individual::FIXED_SCALE); });
+				kernels::gatherAdd(_fixedWeights, indices[0], signs[0], terms, CHUNK, padded, fixedScores);
+				for (size_t m = 0; m < count; m++) {
+					*targets[m] = fixedScores[m] / Individual::FIXED_SCALE;
+				}
+				break;
+			case Precisions::DOUBLE:
+			default:
+				copy(bases, bases + padded, doubleScores);
+				kernels::gatherAdd(_weights, indices[0], signs[0], terms, CHUNK, padded, doubleScores);
+				for (size_t m = 0; m < count; m++) {
+					*targets[m] = doubleScores[m];
+				}
+				break;
+		}
+
+		count = 0;
+		terms = 0;
+	};
+
+	for (const MoveRequest& request : requests) {
+		for (size_t k = 0; k < request.candidates->size(); k++) {
+			int32_t features[TERMS], featureSigns[TERMS];
+			size_t used = Individual::moveTerms(*request.board, (*request.candidates)[k], request.perspective, features, featureSigns);
+
+			// a feature's weight for this individual sits in its column of the feature's row
+			for (size_t t = 0; t < used; t++) {
+				indices[t][count] = features[t] * _stride + request.individual;
+				signs[t][count] = featureSigns[t];
+			}
+
+			// rows this column doesn't use, or that earlier columns didn't, point at weight 0 with sign 0
+			for (size_t t = used; t < terms; t++) {
+				indices[t][count] = 0;
+				signs[t][count] = 0;
+			}
+			for (; terms < used; terms++) {
+				for (size_t earlier = 0; earlier < count; earlier++) {
+					indices[terms][earlier] = 0;
+					signs[terms][earlier] = 0;
+				}
+			}
+
+			bases[count] = request.base;
+			targets[count] = request.scores + k;
+
+			if (++count == CHUNK) {
+				flush();
+			}
+		}
+	}
+
+	if (count > 0) {
+		flush();
+	}
+}
+
+size_t PopulationWeights::size() const {
+	return _size;
+}
+
+PopulationWeights::~PopulationWeights() {
+	::operator delete[](_weights, align_val_t(Individual::WEIGHTS_ALIGNMENT));
+}
\ No newline at end of file
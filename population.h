@@ -0,0 +1,56 @@
+#ifndef POPULATION_H
+#define POPULATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "board.h"
+#include "chesstypes.h"
+#include "representation.h"
+
+// A generation's genomes stored population-major, weights[piece][square][individual], so one position is scored for
+// every individual at once: each occupied square adds one contiguous row of N weights instead of one weight from each
+// of N separate genomes. Built once per generation; it copies the weights and does not track later changes.
+class PopulationWeights {
+public:
+	PopulationWeights(const std::vector<Individual>& population);
+	PopulationWeights(const PopulationWeights& other) = delete;
+
+	// Writes scores[i] = population[i].evaluatePosition(board, perspective, precision) for all size() individuals. Terms
+	// are summed in the order Individual's dot product adds them, so the scores are equal, not merely close.
+	void evaluatePosition(const Board& board, Players perspective, double* scores, Precisions precision = Precisions::DOUBLE) const;
+
+	// one position's candidates, to be scored for one member of the population
+	struct MoveRequest {
+		const Board* board;
+		const std::vector<Candidate>* candidates;
+		Players perspective;
+		std::size_t individual;
+		double base;	  // population[individual]'s score for board, as evaluateMove takes it
+		double* scores;	  // receives one score per candidate
+	};
+
+	// Writes each request's scores as population[individual].evaluateMoves would, exactly. The changed features of every
+	// request's candidates are gathered together from the population-major rows, so several games' plies fill one batch
+	// between them even when each is scored for a different individual.
+	void evaluateMoves(const std::vector<MoveRequest>& requests, Precisions precision = Precisions::DOUBLE) const;
+
+	std::size_t size() const;
+
+	PopulationWeights& operator=(const PopulationWeights& other) = delete;
+
+	~PopulationWeights();
+
+private:
+	std::size_t _size;
+	// row length: the population size rounded up to 16, so every row of every precision stays 32-byte aligned
+	std::size_t _stride;
+
+	// one allocation, like Individual's: doubles, then floats, then int16s, each Individual::WEIGHTS rows of _stride
+	double* _weights;
+	float* _floatWeights;
+	int16_t* _fixedWeights;
+};
+
+#endif
\ No newline at end of file
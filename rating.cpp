@@ -0,0 +1,113 @@
+#include "rating.h"
+
+#include <cmath>
+
+using namespace std;
+
+static double sigmoid(double x) { return 1 / (1 + exp(-x)); }
+
+Ratings fitBradleyTerry(size_t players, const vector<Outcome>& outcomes, double prior) {
+	Ratings out = {.strength = vector<double>(players, 0), .variance = vector<double>(players, 1 / prior), .whiteAdvantage = 0};
+
+	vector<vector<size_t>> involved(players);
+	for (size_t k = 0; k < outcomes.size(); k++) {
+		involved[outcomes[k].white].push_back(k);
+		involved[outcomes[k].black].push_back(k);
+	}
+
+	// coordinate-wise Newton steps on the log posterior; each coordinate is concave, so this converges in a few dozen
+	// sweeps for the sizes we deal with
+	for (int sweep = 0; sweep < 100; sweep++) {
+		double largestStep = 0;
+
+		for (size_t i = 0; i < players; i++) {
+			double gradient = -prior * out.strength[i], information = prior;
+
+			for (size_t k : involved[i]) {
+				const Outcome& game = outcomes[k];
+				double p = sigmoid(out.strength[game.white] - out.strength[game.black] + out.whiteAdvantage);
+				double residual = (game.whiteWon ? 1 : 0) - p;
+
+				gradient += game.white == i ? residual : -residual;
+				information += p * (1 - p);
+			}
+
+			double step = gradient / information;
+			out.strength[i] += step;
+			out.variance[i] = 1 / information;
+			largestStep = max(largestStep, abs(step));
+		}
+
+		double gradient = -prior * out.whiteAdvantage, information = prior;
+		for (const Outcome& game : outcomes) {
+			double p = sigmoid(out.strength[game.white] - out.strength[game.black] + out.whiteAdvantage);
+
+			gradient += (game.whiteWon ? 1 : 0) - p;
+			information += p * (1 - p);
+		}
+
+		double step = gradient / information;
+		out.whiteAdvantage += step;
+		largestStep = max(largestStep, abs(step));
+
+		if (largestStep < 1e-6) {
+			break;
+		}
+	}
+
+	return out;
+}
+
+vector<double> expectedScores(const Ratings& ratings) {
+	size_t players = ratings.strength.size();
+	vector<double> out(players, 0);
+
+	for (size_t i = 0; i < players; i++) {
+		for (size_t j = 0; j < players; j++) {
+			if (i != j) {
+				out[i] += sigmoid(ratings.strength[i] - ratings.strength[j]);
+			}
+		}
+
+		if (players > 1) {
+			out[i] /= players - 1;
+		}
+	}
+
+	return out;
+}
+
+vector<pair<size_t, size_t>> informativePairs(const Ratings& ratings, const vector<vector<bool>>& met) {
+	size_t players = ratings.strength.size();
+	vector<bool> paired(players, false);
+	vector<pair<size_t, size_t>> out;
+
+	while (true) {
+		double bestValue = 0;
+		size_t bestA = players, bestB = players;
+
+		for (size_t a = 0; a < players; a++) {
+			for (size_t b = a + 1; b < players; b++) {
+				if (paired[a] || paired[b] || met[a][b]) {
+					continue;
+				}
+
+				double p = sigmoid(ratings.strength[a] - ratings.strength[b]);
+				double value = (ratings.variance[a] + ratings.variance[b]) * p * (1 - p);
+
+				if (value > bestValue) {
+					bestValue = value;
+					bestA = a;
+					bestB = b;
+				}
+			}
+		}
+
+		if (bestA == players) {
+			return out;
+		}
+
+		paired[bestA] = paired[bestB] = true;
+		out.push_back({bestA, bestB});
+	}
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#ifndef RATING_H
+#define RATING_H
+
+#include <utility>
+#include <vector>
+
+struct Outcome {
+	std::size_t white, black;
+	bool whiteWon;
+};
+
+// Bradley-Terry strengths on the log-odds scale: white beats black with probability
+// sigmoid(strength[white] - strength[black] + whiteAdvantage)
+struct Ratings {
+	std::vector<double> strength;
+	std::vector<double> variance;  // inverse of the observed information, used to steer sampling
+	double whiteAdvantage;
+};
+
+// MAP fit with a zero-mean Gaussian prior of the given precision, which keeps unbeaten or winless players finite and
+// lets individuals with no games at all sit at the average
+Ratings fitBradleyTerry(std::size_t players, const std::vector<Outcome>& outcomes, double prior = 1);
+
+// each player's expected score against the rest of the field, a drop-in replacement for round-robin winrate
+std::vector<double> expectedScores(const Ratings& ratings);
+
+// Greedily pairs players so the next games land where ratings are least certain: a pairing is worth the combined
+// variance of its players times the outcome entropy p(1 - p), and pairs that have already met are skipped (replaying a
+// deterministic game tells us nothing)
+std::vector<std::pair<std::size_t, std::size_t>> informativePairs(const Ratings& ratings, const std::vector<std::vector<bool>>& met);
+
+#endif
\ No newline at end of file
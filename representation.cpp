@@ -1,30 +1,54 @@
 #include "representation.h"
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "kernels.h"
+
 using namespace std;
 
 using json = nlohmann::json;
 
-Individual::Individual(bool random) {
-	for (const PieceTypes type : PIECE_TYPES) {
-		pieceMaps[type] = new double[64];
+// doubles, then floats, then int16s; each section's size is a multiple of the alignment, so all three stay aligned. The
+// tail padding lets kernels::gatherAdd read the last int16 weight 32 bits at a time.
+static constexpr size_t WEIGHT_BYTES = Individual::WEIGHTS * (sizeof(double) + sizeof(float) + sizeof(int16_t)) + Individual::WEIGHTS_ALIGNMENT;
 
-		for (int i = 0; i < 64; i++) {
-			pieceMaps[type][i] = random ? rng::rand() : 0;
-		}
+static double* allocateWeights() {
+	double* out = static_cast<double*>(::operator new[](WEIGHT_BYTES, align_val_t(Individual::WEIGHTS_ALIGNMENT)));
+	memset(out, 0, WEIGHT_BYTES);
+
+	return out;
+}
+
+static void freeWeights(double* weights) {
+	if (weights != nullptr) {
+		::operator delete[](weights, align_val_t(Individual::WEIGHTS_ALIGNMENT));
 	}
 }
 
-Individual::Individual(const Individual& other) {
+Individual::Individual(bool random) : weights(allocateWeights()) {
 	for (const PieceTypes type : PIECE_TYPES) {
-		pieceMaps[type] = new double[64];
-
 		for (int i = 0; i < 64; i++) {
-			pieceMaps[type][i] = other.pieceMaps.at(type)[i];
+			weight(type, i) = random ? rng::rand() : 0;
 		}
 	}
+
+	quantize();
+}
+
+Individual::Individual(const Individual& other) : weights(nullptr), floatWeights(nullptr), fixedWeights(nullptr) { *this = other; }
+
+Individual::Individual(Individual&& other) noexcept : weights(other.weights), floatWeights(other.floatWeights), fixedWeights(other.fixedWeights) {
+	other.weights = nullptr;
+	other.floatWeights = nullptr;
+	other.fixedWeights = nullptr;
 }
 
-Individual::Individual(const json& serialized) {
+Individual::Individual(const json& serialized) : weights(allocateWeights()) {
 	for (const PieceTypes type : PIECE_TYPES) {
 		json arr;
 
@@ -49,13 +73,15 @@ Individual::Individual(const json& serialized) {
 				break;
 		}
 
-		pieceMaps[type] = new double[64];
 		for (int i = 0; i < 64; i++) {
-			pieceMaps[type][i] = arr[i];
+			weight(type, i) = arr[i];
 		}
 	}
+
+	quantize();
 }
 
+#ifdef EXTERNAL_ENGINE
 double Individual::evaluatePosition(const Game& game, Players perspective) const {
 	double advantage = 0;
 
@@ -65,9 +91,9 @@ double Individual::evaluatePosition(const Game& game, Players perspective) const
 				Piece piece = game.getPiece({.file = file, .rank = rank});
 
 				if (piece.player() == perspective) {
-					advantage += pieceMaps.at(piece.type())[file * 8 + rank - 1];
+					advantage += weight(piece.type(), file * 8 + rank - 1);
 				} else {
-					advantage -= pieceMaps.at(piece.type())[file * 8 + rank - 1];
+					advantage -= weight(piece.type(), file * 8 + rank - 1);
 				}
 			}
 		}
@@ -75,6 +101,200 @@ double Individual::evaluatePosition(const Game& game, Players perspective) const
 
 	return advantage;
 }
+#endif
+
+double Individual::evaluatePosition(const Board& board, Players perspective, Precisions precision) const {
+	// one-hot encoding of the board from perspective's side, laid out like the weights
+	alignas(32) int16_t features[WEIGHTS] = {};
+
+	for (int i = 0; i < 64; i++) {
+		const Board::Square& square = board.at(i);
+
+		if (square.occupied) {
+			features[pieceIndex(square.type) * 64 + i] = square.player == perspective ? 1 : -1;
+		}
+	}
+
+	switch (precision) {
+		case Precisions::FLOAT:
+			return kernels::dot(floatWeights, features, WEIGHTS);
+		case Precisions::FIXED16:
+			return kernels::dot(fixedWeights, features, WEIGHTS) / FIXED_SCALE;
+		case Precisions::DOUBLE:
+		default:
+			return kernels::dot(weights, features, WEIGHTS);
+	}
+}
+
+// Signed sum of the weights under each piece, fixed-point weights summing exactly in 64 bits
+template <typename T>
+static double sumPieces(const T* weights, const BitboardGame& game, Players perspective) {
+	conditional_t<is_integral_v<T>, int64_t, double> total = 0;
+
+	for (const PieceTypes type : PIECE_TYPES) {
+		const T* block = weights + Individual::pieceIndex(type) * 64;
+
+		for (const Players player : {Players::WHITE, Players::BLACK}) {
+			decltype(total) sum = 0;
+
+			for (BitboardGame::Bitboard pieces = game.pieces(player, type); pieces != 0; pieces &= pieces - 1) {
+				sum += block[countr_zero(pieces)];
+			}
+
+			total += player == perspective ? sum : -sum;
+		}
+	}
+
+	return total;
+}
+
+double Individual::evaluatePosition(const BitboardGame& game, Players perspective, Precisions precision) const {
+	switch (precision) {
+		case Precisions::FLOAT:
+			return sumPieces(floatWeights, game, perspective);
+		case Precisions::FIXED16:
+			return sumPieces(fixedWeights, game, perspective) / FIXED_SCALE;
+		case Precisions::DOUBLE:
+		default:
+			return sumPieces(weights, game, perspective);
+	}
+}
+
+double Individual::evaluateMove(const Board& board, const Candidate& candidate, Players perspective, double base, Precisions precision) const {
+	Board::Delta delta = board.delta(candidate);
+
+	// accumulated in the evaluation's own type, so base + delta rounds the way a full evaluation in it would
+	auto score = [this, &delta, perspective](auto base, const auto* weights) {
+		for (int i = 0; i < delta.count; i++) {
+			const Board::Square &before = delta.before[i], &after = delta.after[i];
+			int square = delta.squares[i];
+
+			if (before.occupied) {
+				base -= (before.player == perspective ? 1 : -1) * weights[pieceIndex(before.type) * 64 + square];
+			}
+			if (after.occupied) {
+				base += (after.player == perspective ? 1 : -1) * weights[pieceIndex(after.type) * 64 + square];
+			}
+		}
+
+		return base;
+	};
+
+	switch (precision) {
+		case Precisions::FLOAT:
+			return score((float)base, floatWeights);
+		case Precisions::FIXED16:
+			return score((int32_t)lround(base * FIXED_SCALE), fixedWeights) / FIXED_SCALE;
+		case Precisions::DOUBLE:
+		default:
+			return score(base, weights);
+	}
+}
+
+size_t Individual::moveTerms(const Board& board, const Candidate& candidate, Players perspective, int32_t* features, int32_t* signs) {
+	const Move& move = candidate.move;
+	int from = Board::index(move.from), to = Board::index(move.to);
+	const Board::Square &moving = board.at(from), &target = board.at(to);
+	size_t used = 0;
+
+	auto term = [features, signs, &used, perspective](const Board::Square& square, int index, int sign) {
+		features[used] = pieceIndex(square.type) * 64 + index;
+		signs[used] = square.player == perspective ? sign : -sign;
+		used++;
+	};
+
+	// Plain moves and captures are by far the most common, so they skip building a Delta. The terms come out in the same
+	// order delta() would list them: the destination first, then the origin.
+	bool special = (moving.type == PieceTypes::KING && abs((int)move.to.file - (int)move.from.file) == 2) ||
+				   (moving.type == PieceTypes::PAWN && move.from.file != move.to.file && !target.occupied);
+
+	if (!special) {
+		Board::Square placed = moving;
+		if (candidate.promotion != PieceTypes::PAWN) {
+			placed.type = candidate.promotion;
+		}
+
+		if (target.occupied) {
+			term(target, to, -1);
+		}
+		if (moving.occupied) {
+			term(placed, to, 1);
+			term(moving, from, -1);
+		}
+
+		return used;
+	}
+
+	Board::Delta delta = board.delta(candidate);
+	for (int i = 0; i < delta.count; i++) {
+		const Board::Square &before = delta.before[i], &after = delta.after[i];
+
+		if (before.occupied) {
+			term(before, delta.squares[i], -1);
+		}
+		if (after.occupied) {
+			term(after, delta.squares[i], 1);
+		}
+	}
+
+	return used;
+}
+
+void Individual::evaluateMoves(const Board& board, const vector<Candidate>& candidates, Players perspective, double base, double* scores,
+							   Precisions precision) const {
+	constexpr size_t CHUNK = 256;
+	alignas(32) int32_t indices[MOVE_TERMS][CHUNK], signs[MOVE_TERMS][CHUNK];
+	alignas(32) double doubleScores[CHUNK];
+	alignas(32) float floatScores[CHUNK];
+	alignas(32) int32_t fixedScores[CHUNK];
+
+	for (size_t first = 0; first < candidates.size(); first += CHUNK) {
+		size_t count = min(CHUNK, candidates.size() - first), padded = (count + 7) / 8 * 8, terms = 0;
+
+		// terms are laid out in the order evaluateMove adds them, so both agree exactly; unused slots point at weight 0
+		// with sign 0
+		for (size_t m = 0; m < padded; m++) {
+			int32_t features[MOVE_TERMS], featureSigns[MOVE_TERMS];
+			size_t used = m < count ? moveTerms(board, candidates[first + m], perspective, features, featureSigns) : 0;
+
+			for (size_t t = 0; t < used; t++) {
+				indices[t][m] = features[t];
+				signs[t][m] = featureSigns[t];
+			}
+
+			// rows past the widest move so far are only cleared once some move needs them
+			for (; terms < used; terms++) {
+				for (size_t earlier = 0; earlier < m; earlier++) {
+					indices[terms][earlier] = 0;
+					signs[terms][earlier] = 0;
+				}
+			}
+			for (; used < terms; used++) {
+				indices[used][m] = 0;
+				signs[used][m] = 0;
+			}
+		}
+
+		switch (precision) {
+			case Precisions::FLOAT:
+				fill(floatScores, floatScores + padded, (float)base);
+				kernels::gatherAdd(floatWeights, indices[0], signs[0], terms, CHUNK, padded, floatScores);
+				copy(floatScores, floatScores + count, scores + first);
+				break;
+			case Precisions::FIXED16:
+				fill(fixedScores, fixedScores + padded, (int32_t)lround(base * FIXED_SCALE));
+				kernels::gatherAdd(fixedWeights, indices[0], signs[0], terms, CHUNK, padded, fixedScores);
+				transform(fixedScores, fixedScores + count, scores + first, [](int32_t score) { return score / FIXED_SCALE; });
+				break;
+			case Precisions::DOUBLE:
+			default:
+				fill(doubleScores, doubleScores + padded, base);
+				kernels::gatherAdd(weights, indices[0], signs[0], terms, CHUNK, padded, doubleScores);
+				copy(doubleScores, doubleScores + count, scores + first);
+				break;
+		}
+	}
+}
 
 json Individual::serialize() const {
 	json out;
@@ -83,7 +303,7 @@ json Individual::serialize() const {
 		json arr = json::array();
 
 		for (int i = 0; i < 64; i++) {
-			arr.push_back(pieceMaps.at(type)[i]);
+			arr.push_back(weight(type, i));
 		}
 
 		switch (type) {
@@ -111,6 +331,33 @@ json Individual::serialize() const {
 	return out;
 }
 
+uint64_t Individual::hash() const {
+	uint64_t out = 0;
+
+	for (size_t i = 0; i < WEIGHTS; i++) {
+		uint64_t bits;
+		memcpy(&bits, &weights[i], sizeof(bits));
+
+		// splitmix64 finalizer over the running state, so that every bit of every weight reaches every output bit
+		out += bits + 0x9e3779b97f4a7c15;
+		out = (out ^ (out >> 30)) * 0xbf58476d1ce4e5b9;
+		out = (out ^ (out >> 27)) * 0x94d049bb133111eb;
+		out ^= out >> 31;
+	}
+
+	return out;
+}
+
+void Individual::quantize() {
+	floatWeights = reinterpret_cast<float*>(weights + WEIGHTS);
+	fixedWeights = reinterpret_cast<int16_t*>(floatWeights + WEIGHTS);
+
+	for (size_t i = 0; i < WEIGHTS; i++) {
+		floatWeights[i] = weights[i];
+		fixedWeights[i] = clamp<long>(lround(weights[i] * FIXED_SCALE), INT16_MIN, INT16_MAX);
+	}
+}
+
 Individual mutate(const Individual& source, double freq) {
 	Individual out = source;
 
@@ -118,12 +365,14 @@ Individual mutate(const Individual& source, double freq) {
 		for (const Files file : FILES) {
 			for (const uint rank : RANKS) {
 				if (rng::rand() < freq) {
-					out.pieceMaps[type][file * 8 + rank - 1] += rng::rand(0.2) - 0.1;
+					out.weight(type, file * 8 + rank - 1) += rng::rand(0.2) - 0.1;
 				}
 			}
 		}
 	}
 
+	out.quantize();
+
 	return out;
 }
 
@@ -139,29 +388,75 @@ Individual cross(const Individual& a, const Individual& b) {
 		for (const Files file : FILES) {
 			for (const uint rank : RANKS) {
 				if ((top ? rank >= pivotRank : rank <= pivotRank) && (right ? file >= pivotFile : rank <= pivotFile)) {
-					out.pieceMaps[type][file * 8 + rank - 1] = a.pieceMaps.at(type)[file * 8 + rank - 1];
+					out.weight(type, file * 8 + rank - 1) = a.weight(type, file * 8 + rank - 1);
 				} else {
-					out.pieceMaps[type][file * 8 + rank - 1] = b.pieceMaps.at(type)[file * 8 + rank - 1];
+					out.weight(type, file * 8 + rank - 1) = b.weight(type, file * 8 + rank - 1);
 				}
 			}
 		}
 	}
 
+	out.quantize();
+
 	return out;
 }
 
 Individual& Individual::operator=(const Individual& other) {
-	for (const PieceTypes type : PIECE_TYPES) {
-		for (int i = 0; i < 64; i++) {
-			pieceMaps[type][i] = other.pieceMaps.at(type)[i];
-		}
+	if (this == &other) {
+		return *this;
 	}
 
+	// a copy of a moved-from individual is moved-from too
+	if (other.weights == nullptr) {
+		freeWeights(weights);
+		weights = nullptr;
+		floatWeights = nullptr;
+		fixedWeights = nullptr;
+
+		return *this;
+	}
+
+	if (weights == nullptr) {
+		weights = allocateWeights();
+		floatWeights = reinterpret_cast<float*>(weights + WEIGHTS);
+		fixedWeights = reinterpret_cast<int16_t*>(floatWeights + WEIGHTS);
+	}
+
+	memcpy(weights, other.weights, WEIGHT_BYTES);
+
 	return *this;
 }
 
-Individual::~Individual() {
-	for (const PieceTypes type : PIECE_TYPES) {
-		delete[] pieceMaps[type];
+Individual& Individual::operator=(Individual&& other) noexcept {
+	if (this != &other) {
+		freeWeights(weights);
+		weights = other.weights;
+		floatWeights = other.floatWeights;
+		fixedWeights = other.fixedWeights;
+		other.weights = nullptr;
+		other.floatWeights = nullptr;
+		other.fixedWeights = nullptr;
+	}
+
+	return *this;
+}
+
+Individual::~Individual() { freeWeights(weights); }
+
+size_t Individual::pieceIndex(PieceTypes type) {
+	switch (type) {
+		case PieceTypes::PAWN:
+			return 0;
+		case PieceTypes::KNIGHT:
+			return 1;
+		case PieceTypes::BISHOP:
+			return 2;
+		case PieceTypes::ROOK:
+			return 3;
+		case PieceTypes::QUEEN:
+			return 4;
+		case PieceTypes::KING:
+		default:
+			return 5;
 	}
 }
\ No newline at end of file
@@ -1,26 +1,80 @@
 #ifndef REPRESENTATION_H
 #define REPRESENTATION_H
 
-#include <map>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 
-#include "engine/chess.h"
+#include "bitboard.h"
+#include "board.h"
+#include "game.h"
 #include "json.hpp"
 #include "rng.h"
 
+// Scalar type evaluation runs in. The genome always evolves and serializes as doubles; the narrower types are rounded
+// copies that fit two or four times as many weights per SIMD register.
+enum class Precisions { DOUBLE, FLOAT, FIXED16 };
+
 struct Individual {
 	Individual(bool random = false);
 	Individual(const Individual& other);
+	Individual(Individual&& other) noexcept;
 	Individual(const nlohmann::json& serialized);
 
+#ifdef EXTERNAL_ENGINE
+	// the engine's Game, probed square by square
 	double evaluatePosition(const Game& game, Players perspective) const;
+#endif
+	double evaluatePosition(const Board& board, Players perspective, Precisions precision = Precisions::DOUBLE) const;
+	// Same score, walking the set bits of each piece set instead of all 64 squares, so a position with n pieces costs n
+	// weight lookups
+	double evaluatePosition(const BitboardGame& game, Players perspective, Precisions precision = Precisions::DOUBLE) const;
+	// Score of the position after candidate, given base = evaluatePosition(board, perspective, precision). Only the few
+	// squares the move touches are looked at, so ranking a ply's candidates costs O(moves) rather than O(moves * 64).
+	double evaluateMove(const Board& board, const Candidate& candidate, Players perspective, double base,
+						Precisions precision = Precisions::DOUBLE) const;
+	// Scores every candidate in one call, writing scores[i] for candidates[i], given base as evaluateMove takes it. The
+	// features each candidate changes are gathered from the weights several candidates at a time, and the results match
+	// evaluateMove exactly.
+	void evaluateMoves(const Board& board, const std::vector<Candidate>& candidates, Players perspective, double base, double* scores,
+					   Precisions precision = Precisions::DOUBLE) const;
 
 	nlohmann::json serialize() const;
 
+	// content hash of the weights; equal genomes hash equally
+	uint64_t hash() const;
+
 	Individual& operator=(const Individual& other);
+	Individual& operator=(Individual&& other) noexcept;
 
 	~Individual();
 
-	std::map<PieceTypes, double*> pieceMaps;
+	static constexpr std::size_t WEIGHTS = 6 * 64;
+	static constexpr std::size_t WEIGHTS_ALIGNMENT = 64;
+	// fixed-point weights are round(weight * FIXED_SCALE), saturated to the int16 range
+	static constexpr double FIXED_SCALE = 1024;
+
+	// position of each piece type's 64 squares within weights: pawn, knight, bishop, rook, queen, king
+	static std::size_t pieceIndex(PieceTypes type);
+
+	// most features one move changes: up to 4 squares, each losing one piece and gaining another
+	static constexpr std::size_t MOVE_TERMS = 8;
+	// Writes the features playing candidate changes, as indices into weights, with the sign each is added with, in the
+	// order evaluateMove adds them, so a sum over them rounds the same way. Returns how many there are.
+	static std::size_t moveTerms(const Board& board, const Candidate& candidate, Players perspective, int32_t* features, int32_t* signs);
+
+	double& weight(PieceTypes type, int square) { return weights[pieceIndex(type) * 64 + square]; }
+	double weight(PieceTypes type, int square) const { return weights[pieceIndex(type) * 64 + square]; }
+
+	// refreshes floatWeights and fixedWeights; needed after writing to weights directly
+	void quantize();
+
+	// One contiguous, cache-line aligned block of 6 x 64 piece-square weights, squares indexed file * 8 + rank - 1. Null
+	// only in an individual that has been moved from.
+	double* weights;
+	// the same weights rounded to each narrower precision, stored in the same allocation right after weights
+	float* floatWeights;
+	int16_t* fixedWeights;
 
 	// Evolution operators
 	friend Individual mutate(const Individual& source, double freq);
@@ -0,0 +1,27 @@
+#include "sprt.h"
+
+#include <cmath>
+
+using namespace std;
+
+SPRT::SPRT(const SPRTConfig& config)
+	: _llr(0),
+	  _lower(log(config.beta / (1 - config.alpha))),
+	  _upper(log((1 - config.beta) / config.alpha)),
+	  _step(log((0.5 + config.margin) / (0.5 - config.margin))) {}
+
+SPRTDecisions SPRT::add(bool firstWon) {
+	_llr += firstWon ? _step : -_step;
+
+	return decision();
+}
+
+SPRTDecisions SPRT::decision() const {
+	if (_llr >= _upper) {
+		return SPRTDecisions::FIRST_STRONGER;
+	} else if (_llr <= _lower) {
+		return SPRTDecisions::SECOND_STRONGER;
+	} else {
+		return SPRTDecisions::CONTINUE;
+	}
+}
\ No newline at end of file
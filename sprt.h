@@ -0,0 +1,28 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+enum class SPRTDecisions { CONTINUE, FIRST_STRONGER, SECOND_STRONGER };
+
+struct SPRTConfig {
+	double alpha;	// chance of calling the first player stronger when the second is
+	double beta;	// and vice versa
+	double margin;	// the hypotheses are a per-game score of 0.5 - margin and 0.5 + margin for the first player
+};
+
+// Wald's sequential probability ratio test over a stream of win/loss results between two players. Each result moves the
+// log-likelihood ratio one step, and testing stops as soon as it leaves the band set by alpha and beta.
+class SPRT {
+public:
+	SPRT(const SPRTConfig& config);
+
+	SPRTDecisions add(bool firstWon);
+
+	SPRTDecisions decision() const;
+
+private:
+	double _llr;
+	double _lower, _upper;
+	double _step;  // added per win of the first player, subtracted per loss (the hypotheses are symmetric)
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,854 @@
+#include "tournament.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+#include "rating.h"
+#include "sprt.h"
+
+using namespace std;
+
+vector<Game> openingPositions(size_t count) {
+	vector<Game> out;
+
+	if (count == 0) {
+		return out;
+	}
+
+	out.push_back(Game());
+
+	vector<Game> candidates;
+	for (const Move& reply : Game().getAvailableMoves()) {
+		Game afterWhite = Game().branch(reply);
+
+		for (const Move& response : afterWhite.getAvailableMoves()) {
+			candidates.push_back(afterWhite.branch(response));
+		}
+	}
+
+	for (size_t i = 0; i + 1 < count && i < candidates.size(); i++) {
+		out.push_back(candidates[i * candidates.size() / (count - 1)]);
+	}
+
+	return out;
+}
+
+// Key for everything a side's choice depends on besides its genome: the pieces, the side to move, and the legal moves
+// in the order the engine lists them, which both stand in for the castling and en passant rights the board doesn't
+// track and decide ties between equally scored moves
+static uint64_t choiceKey(const Board& board, Players side, const vector<Move>& moves) {
+	uint64_t key = board.hash(side);
+
+	for (const Move& move : moves) {
+		key = (key ^ (uint64_t)(Board::index(move.from) << 6 | Board::index(move.to))) * 0x100000001b3;
+	}
+
+	return key;
+}
+
+static bool sameCandidate(const Candidate& a, const Candidate& b) {
+	return a.move.from.file == b.move.from.file && a.move.from.rank == b.move.from.rank && a.move.to.file == b.move.to.file &&
+		   a.move.to.rank == b.move.to.rank && a.promotion == b.promotion;
+}
+
+// Scratch buffers for the game driver, one set per thread, reserved up front and kept for the thread's lifetime, so
+// once a thread has played its first game, generating and choosing a move makes no heap allocations.
+struct Workspace {
+	// more than the most moves any legal chess position has, so the buffers never need to grow
+	static constexpr size_t CAPACITY = 256;
+
+	// a ply's legal moves, the candidates expanded from them and the mover's scores for those
+	struct Lists {
+		vector<Move> moves;
+		vector<Candidate> candidates;
+		vector<double> scores;
+	};
+
+	// Lists for the slot'th game this thread has in flight: slot 0 under per-game and tree execution, one per game of a
+	// lockstep batch. They live in a deque, so adding one never moves those already handed out.
+	Lists& lists(size_t slot) {
+		while (slots.size() <= slot) {
+			Lists& added = slots.emplace_back();
+			added.moves.reserve(CAPACITY);
+			added.candidates.reserve(CAPACITY);
+			added.scores.reserve(CAPACITY);
+		}
+
+		return slots[slot];
+	}
+
+	deque<Lists> slots;
+	// a tree node's base scores for the whole population, sized to it on first use
+	vector<double> bases;
+};
+
+static thread_local Workspace workspace;
+
+// Index of the candidate mover rates highest, the first of any tie, given base = mover's score for board. Candidates
+// are scored into scores as differences from the current position, all in one evaluateMoves call. Against scoring them
+// one at a time, bench has the batch within about 10% either way depending on run and precision, and whole generations
+// take the same time within noise.
+static size_t bestMove(const Individual& mover, const Board& board, const vector<Candidate>& candidates, Players side, double base,
+					   Precisions precision, vector<double>& scores) {
+	scores.resize(candidates.size());
+	mover.evaluateMoves(board, candidates, side, base, scores.data(), precision);
+
+	return max_element(scores.begin(), scores.end()) - scores.begin();
+}
+
+// Result of a game that ended in game after halfMoves. moves is game's legal move list, which the driver already has
+// from deciding the game was over, so it isn't generated again.
+static GameResult outcome(const Game& game, const vector<Move>& moves, uint halfMoves) {
+	if (moves.empty()) {
+		// side to move is checkmated
+		return {.winner = game.turn() == Players::BLACK ? Players::WHITE : Players::BLACK, .halfMoves = halfMoves};
+	} else {
+		// tiebreak by materiel
+		return {.winner = game.materiel(Players::WHITE) > game.materiel(Players::BLACK) ? Players::WHITE : Players::BLACK, .halfMoves = halfMoves};
+	}
+}
+
+// One game in progress. A ply is played in three steps, generate, choose and apply, so that lockstep execution can run
+// each step across a whole batch of games before moving on to the next.
+struct GameState {
+	const Individual* white;
+	const Individual* black;
+	uint64_t whiteHash, blackHash;	// only needed with a move cache
+
+	Game game;
+	uint halfMoves;
+
+	// the ply being played; moves, candidates and scores are one of the thread's workspace slots
+	vector<Move>* moves;
+	vector<Candidate>* candidates;
+	vector<double>* scores;
+	optional<Board> board;
+	Players side;
+	uint64_t key;
+	Candidate choice;
+	bool cached;
+};
+
+static GameState startGame(const Individual& white, const Individual& black, const Game& start, MoveCache* choices, Workspace::Lists& lists) {
+	return {.white = &white,
+			.black = &black,
+			.whiteHash = choices != nullptr ? white.hash() : 0,
+			.blackHash = choices != nullptr ? black.hash() : 0,
+			.game = start,
+			.halfMoves = 0,
+			.moves = &lists.moves,
+			.candidates = &lists.candidates,
+			.scores = &lists.scores,
+			.board = nullopt,
+			.side = Players::WHITE,
+			.key = 0,
+			.choice = {},
+			.cached = false};
+}
+
+// Lists the candidates for the next ply, or returns false once the game is over. Move generation is the engine's
+// most expensive call, so the one list is both the terminal test and the candidates, and outcome reuses it.
+static bool generate(GameState& state, MoveCache* choices) {
+	availableMoves(state.game, *state.moves);
+
+	if (state.moves->empty() || state.halfMoves >= 200) {
+		return false;
+	}
+
+	state.side = state.game.turn();
+	state.board.emplace(state.game);
+	state.board->expand(*state.moves, *state.candidates);
+	state.key = choices != nullptr ? choiceKey(*state.board, state.side, *state.moves) : 0;
+
+	return true;
+}
+
+// Takes the move from the cache if the mover has been here before, returning whether it did. A cached move is only
+// trusted if it is still a candidate, which guards against key collisions.
+static bool recall(GameState& state, MoveCache* choices) {
+	uint64_t genome = state.side == Players::WHITE ? state.whiteHash : state.blackHash;
+	const vector<Candidate>& candidates = *state.candidates;
+
+	state.cached = choices != nullptr && choices->get(genome, state.key, state.halfMoves, state.choice) &&
+				   any_of(candidates.begin(), candidates.end(), [&state](const Candidate& candidate) { return sameCandidate(candidate, state.choice); });
+
+	return state.cached;
+}
+
+// picks the move, from the cache if the mover has been here before and by scoring the candidates otherwise
+static void choose(GameState& state, Precisions precision, MoveCache* choices) {
+	const Individual& mover = state.side == Players::WHITE ? *state.white : *state.black;
+	const vector<Candidate>& candidates = *state.candidates;
+
+	if (!recall(state, choices)) {
+		double base = mover.evaluatePosition(*state.board, state.side, precision);
+		state.choice = candidates[bestMove(mover, *state.board, candidates, state.side, base, precision, *state.scores)];
+	}
+}
+
+// plays the chosen move, remembering it for the next time the mover reaches this position
+static void apply(GameState& state, MoveCache* choices) {
+	playMove(state.game, state.choice.move, state.choice.promotion);
+
+	if (choices != nullptr && !state.cached) {
+		choices->put(state.side == Players::WHITE ? state.whiteHash : state.blackHash, state.key, state.choice);
+	}
+
+	state.halfMoves++;
+}
+
+GameResult playGame(const Individual& white, const Individual& black, const Game& start, Precisions precision, MoveCache* choices) {
+	GameState state = startGame(white, black, start, choices, workspace.lists(0));
+
+	try {
+		while (generate(state, choices)) {
+			choose(state, precision, choices);
+			apply(state, choices);
+		}
+
+		return outcome(state.game, *state.moves, state.halfMoves);
+	} catch (const runtime_error& e) {
+		throw GameError(e.what(), state.game.dumpFEN());
+	}
+}
+
+struct alignas(64) Progress {
+	atomic<size_t> completed{0};
+	atomic<size_t> moves{0};
+};
+
+// What playing one game reports. Each game's slot fills a cache line of its own, so workers finishing neighbouring
+// games never write to the same line; the results are copied out once the batch is done.
+struct alignas(64) GameSlot {
+	optional<GameResult> result;
+	chrono::steady_clock::time_point started, finished;
+};
+
+// A position some of a batch's games have reached together. games are indices into the batch's play order.
+struct TreeNode {
+	Game game;
+	uint halfMoves;
+	vector<size_t> games;
+};
+
+// what every task of one batch's execution shares
+struct BatchContext {
+	const vector<Individual>& population;
+	const vector<uint64_t>& hashes;
+	const vector<Pairing>& pairings;
+	const vector<size_t>& order;
+	const TournamentConfig& config;
+	ThreadPool& pool;
+	vector<GameSlot>& slots;  // indexed like order
+	vector<Progress>& progress;
+	mutex& errorLock;
+	MoveCache* choices;
+	const PopulationWeights* layout;
+};
+
+// Plays node's games onward together. At each ply the games are split by the genome of the side to move, as only games
+// with the same mover make the same move, and each part becomes a child position. The first child is carried on by
+// this task and the rest are handed to the pool, so every distinct position is scored once however many games pass it.
+static void expandNode(TreeNode node, BatchContext& context) {
+	auto taskStart = chrono::steady_clock::now();
+	Progress& progress = context.progress[ThreadPool::workerIndex()];
+
+	// games grouped by the content hash of one of their players, in first-seen order
+	auto split = [&context](const vector<size_t>& games, Players side) {
+		vector<pair<uint64_t, vector<size_t>>> groups;
+
+		for (size_t n : games) {
+			const Pairing& pairing = context.pairings[context.order[n]];
+			uint64_t genome = context.hashes[side == Players::WHITE ? pairing.white : pairing.black];
+
+			auto group = find_if(groups.begin(), groups.end(), [genome](const auto& group) { return group.first == genome; });
+			if (group == groups.end()) {
+				groups.push_back({genome, {n}});
+			} else {
+				group->second.push_back(n);
+			}
+		}
+
+		return groups;
+	};
+
+	// population index of one of game n's players
+	auto player = [&context](size_t n, Players side) {
+		const Pairing& pairing = context.pairings[context.order[n]];
+		return side == Players::WHITE ? pairing.white : pairing.black;
+	};
+
+	try {
+		vector<Move>& moves = workspace.lists(0).moves;
+		vector<Candidate>& candidates = workspace.lists(0).candidates;
+		vector<double>& scores = workspace.lists(0).scores;
+		availableMoves(node.game, moves);
+		vector<double>& bases = workspace.bases;
+
+		while (!moves.empty() && node.halfMoves < 200) {
+			Players side = node.game.turn();
+			Board board(node.game);
+			board.expand(moves, candidates);
+
+			// A position many movers share, typically near an opening root, is scored for the whole population in one
+			// population-major pass rather than once per mover; bench has that pass costing about a dozen single scorings.
+			vector<pair<uint64_t, vector<size_t>>> groups = split(node.games, side);
+			bool together = context.layout != nullptr && groups.size() > 1 && groups.size() * 12 >= context.population.size();
+
+			if (together) {
+				bases.resize(context.population.size());
+				context.layout->evaluatePosition(board, side, bases.data(), context.config.precision);
+			}
+
+			vector<TreeNode> children;
+			for (auto& [genome, games] : groups) {
+				size_t index = player(games[0], side);
+				const Individual& mover = context.population[index];
+				double base = together ? bases[index] : mover.evaluatePosition(board, side, context.config.precision);
+
+				Game after = node.game;
+				const Candidate& choice = candidates[bestMove(mover, board, candidates, side, base, context.config.precision, scores)];
+				playMove(after, choice.move, choice.promotion);
+				progress.moves.fetch_add(1, memory_order_relaxed);
+
+				children.push_back({.game = move(after), .halfMoves = node.halfMoves + 1, .games = move(games)});
+			}
+
+			for (size_t k = 1; k < children.size(); k++) {
+				context.pool.submit([child = move(children[k]), &context]() mutable { expandNode(move(child), context); });
+			}
+
+			node = move(children[0]);
+			availableMoves(node.game, moves);
+		}
+
+		GameResult result = outcome(node.game, moves, node.halfMoves);
+		auto now = chrono::steady_clock::now();
+
+		for (size_t n : node.games) {
+			context.slots[n].result = result;
+			context.slots[n].started = taskStart;
+			context.slots[n].finished = now;
+		}
+	} catch (const runtime_error& e) {
+		lock_guard guard(context.errorLock);
+		cerr << "Game error: " << e.what() << endl;
+		cerr << "FEN Dump: " << node.game.dumpFEN() << endl;
+
+		auto now = chrono::steady_clock::now();
+		for (size_t n : node.games) {
+			context.slots[n].started = taskStart;
+			context.slots[n].finished = now;
+		}
+	}
+
+	progress.completed.fetch_add(node.games.size(), memory_order_relaxed);
+}
+
+// Advances a batch of games together a ply at a time: every game still going generates its candidates, then every game
+// chooses, then every game applies its move. With the population-major layout, the choose step scores the candidates of
+// every game the move cache can't answer in one batch across the games, each against its own mover's column of the
+// layout; without it, each game scores its own. bench has the cross-game gathers 5-18% behind scoring each game from
+// its own genome, as they reach into rows spread across the population, and whole generations take the same time
+// within noise. batch holds indices into the play order.
+static void playLockstep(vector<size_t> batch, BatchContext& context) {
+	auto taskStart = chrono::steady_clock::now();
+	Progress& progress = context.progress[ThreadPool::workerIndex()];
+
+	vector<GameState> states;
+	for (size_t n : batch) {
+		const Pairing& pairing = context.pairings[context.order[n]];
+
+		states.push_back(startGame(context.population[pairing.white], context.population[pairing.black], context.config.openings[pairing.opening],
+								   context.choices, workspace.lists(states.size())));
+		context.slots[n].started = taskStart;
+	}
+
+	auto finish = [&context, &progress, &batch](size_t k) {
+		context.slots[batch[k]].finished = chrono::steady_clock::now();
+		progress.completed.fetch_add(1, memory_order_relaxed);
+	};
+
+	// the games still going, and room to build the next list in without allocating
+	vector<size_t> going(states.size()), kept;
+	iota(going.begin(), going.end(), 0);
+	kept.reserve(going.size());
+
+	vector<PopulationWeights::MoveRequest> requests;
+	requests.reserve(states.size());
+
+	// runs one step over the games still going, keeping those it returns true for; a game that throws is left without
+	// a result, as under per-game execution
+	auto step = [&context, &states, &finish, &going, &kept](const auto& body) {
+		kept.clear();
+
+		for (size_t k : going) {
+			try {
+				if (body(k, states[k])) {
+					kept.push_back(k);
+				}
+			} catch (const runtime_error& e) {
+				lock_guard guard(context.errorLock);
+				cerr << "Game error: " << e.what() << endl;
+				cerr << "FEN Dump: " << states[k].game.dumpFEN() << endl;
+				finish(k);
+			}
+		}
+
+		going.swap(kept);
+	};
+
+	while (!going.empty()) {
+		step([&context, &progress, &batch, &finish](size_t k, GameState& state) {
+			if (generate(state, context.choices)) {
+				return true;
+			}
+
+			context.slots[batch[k]].result = outcome(state.game, *state.moves, state.halfMoves);
+			progress.moves.fetch_add(state.halfMoves, memory_order_relaxed);
+			finish(k);
+			return false;
+		});
+		if (context.layout != nullptr) {
+			requests.clear();
+			step([&context, &batch, &requests](size_t k, GameState& state) {
+				if (!recall(state, context.choices)) {
+					const Pairing& pairing = context.pairings[context.order[batch[k]]];
+					size_t mover = state.side == Players::WHITE ? pairing.white : pairing.black;
+					double base = context.population[mover].evaluatePosition(*state.board, state.side, context.config.precision);
+
+					state.scores->resize(state.candidates->size());
+					requests.push_back({.board = &*state.board,
+										.candidates = state.candidates,
+										.perspective = state.side,
+										.individual = mover,
+										.base = base,
+										.scores = state.scores->data()});
+				}
+				return true;
+			});
+
+			context.layout->evaluateMoves(requests, context.config.precision);
+
+			// the first of any tie, as bestMove picks
+			step([](size_t, GameState& state) {
+				if (!state.cached) {
+					state.choice = (*state.candidates)[max_element(state.scores->begin(), state.scores->end()) - state.scores->begin()];
+				}
+				return true;
+			});
+		} else {
+			step([&context](size_t, GameState& state) {
+				choose(state, context.config.precision, context.choices);
+				return true;
+			});
+		}
+		step([&context](size_t, GameState& state) {
+			apply(state, context.choices);
+			return true;
+		});
+	}
+}
+
+vector<optional<GameResult>> playGames(const vector<Individual>& population, const vector<uint64_t>& hashes, const vector<Pairing>& pairings,
+									   const TournamentConfig& config, ThreadPool& pool, ResultCache& cache, MoveCache* choices, const PopulationWeights* layout,
+									   TournamentStats& stats) {
+	vector<optional<GameResult>> results(pairings.size());
+
+	// games already in the cache are settled here, and only the rest are handed to the pool
+	vector<size_t> order;
+	for (size_t k = 0; k < pairings.size(); k++) {
+		GameResult result;
+
+		if (cache.get({.white = hashes[pairings[k].white], .black = hashes[pairings[k].black], .opening = pairings[k].opening}, result)) {
+			results[k] = result;
+			stats.cached++;
+		} else {
+			order.push_back(k);
+		}
+	}
+
+	stable_sort(order.begin(), order.end(), [&pairings](size_t a, size_t b) { return pairings[a].expectedLength > pairings[b].expectedLength; });
+
+	size_t games = order.size();
+
+	// every game writes only its own slot and per-worker progress counters, each on a cache line of its own, so reporting
+	// a result never contends with another worker
+	vector<Progress> progress(pool.size());
+	vector<GameSlot> slots(games);
+
+	mutex errorLock;
+	BatchContext context = {.population = population,
+						   .hashes = hashes,
+						   .pairings = pairings,
+						   .order = order,
+						   .config = config,
+						   .pool = pool,
+						   .slots = slots,
+						   .progress = progress,
+						   .errorLock = errorLock,
+						   .choices = choices,
+						   .layout = layout};
+
+	switch (config.execution) {
+		case Executions::TREE:
+			// one root per opening, holding every game that starts from it
+			for (size_t opening = 0; opening < config.openings.size(); opening++) {
+				TreeNode root = {.game = config.openings[opening], .halfMoves = 0, .games = {}};
+
+				for (size_t n = 0; n < games; n++) {
+					if (pairings[order[n]].opening == opening) {
+						root.games.push_back(n);
+					}
+				}
+
+				if (!root.games.empty()) {
+					pool.submit([root = move(root), &context]() mutable { expandNode(move(root), context); });
+				}
+			}
+			break;
+		case Executions::LOCKSTEP:
+			// the play order is longest-expected-first, so neighbouring games make batches that finish close together
+			for (size_t first = 0; first < games; first += max<size_t>(config.lockstep, 1)) {
+				vector<size_t> batch(min(games - first, max<size_t>(config.lockstep, 1)));
+				iota(batch.begin(), batch.end(), first);
+
+				pool.submit([batch = move(batch), &context]() mutable { playLockstep(move(batch), context); });
+			}
+			break;
+		case Executions::GAMES:
+		default:
+			for (size_t n = 0; n < games; n++) {
+				pool.submit([&errorLock, &progress, &population, &pairings, &config, &order, &slots, choices, n]() {
+					const Pairing& pairing = pairings[order[n]];
+					slots[n].started = chrono::steady_clock::now();
+
+					try {
+						slots[n].result = playGame(population[pairing.white], population[pairing.black], config.openings[pairing.opening],
+												   config.precision, choices);
+						progress[ThreadPool::workerIndex()].moves.fetch_add(slots[n].result->halfMoves, memory_order_relaxed);
+					} catch (const GameError& e) {
+						lock_guard guard(errorLock);
+						cerr << "Game error: " << e.what() << endl;
+						cerr << "FEN Dump: " << e.fen() << endl;
+					}
+
+					slots[n].finished = chrono::steady_clock::now();
+					progress[ThreadPool::workerIndex()].completed.fetch_add(1, memory_order_relaxed);
+				});
+			}
+			break;
+	}
+
+	while (!pool.waitFor(chrono::milliseconds(500))) {
+		size_t completed = 0;
+		for (const Progress& worker : progress) {
+			completed += worker.completed.load(memory_order_relaxed);
+		}
+
+		cout << "Evaluation " << ((double)completed / games * 100) << "% complete" << endl;
+	}
+
+	if (games > 0) {
+		auto lastStart = max_element(slots.begin(), slots.end(), [](const GameSlot& a, const GameSlot& b) { return a.started < b.started; })->started;
+		auto lastFinish = max_element(slots.begin(), slots.end(), [](const GameSlot& a, const GameSlot& b) { return a.finished < b.finished; })->finished;
+		stats.tailTime += chrono::duration<double>(lastFinish - lastStart).count();
+	}
+
+	for (size_t n = 0; n < games; n++) {
+		results[order[n]] = slots[n].result;
+	}
+
+	stats.played += games;
+	for (const Progress& worker : progress) {
+		stats.moves += worker.moves.load(memory_order_relaxed);
+	}
+
+	for (size_t k : order) {
+		if (results[k]) {
+			cache.put({.white = hashes[pairings[k].white], .black = hashes[pairings[k].black], .opening = pairings[k].opening}, *results[k]);
+		}
+	}
+
+	return results;
+}
+
+// Pairs each player with the nearest unpaired player below it in the standings that it hasn't met yet. Players with no
+// unmet opponent left sit the round out: play is deterministic, so a rematch would only count the cached result twice.
+static vector<pair<size_t, size_t>> swissPairs(const vector<size_t>& standings, const vector<vector<bool>>& met) {
+	vector<bool> paired(met.size(), false);
+	vector<pair<size_t, size_t>> out;
+
+	for (size_t n = 0; n < standings.size(); n++) {
+		size_t a = standings[n], opponent = met.size();
+
+		if (paired[a]) {
+			continue;
+		}
+
+		for (size_t m = n + 1; m < standings.size(); m++) {
+			size_t b = standings[m];
+
+			if (!paired[b] && !met[a][b]) {
+				opponent = b;
+				break;
+			}
+		}
+
+		if (opponent != met.size()) {
+			paired[a] = paired[opponent] = true;
+			out.push_back({a, opponent});
+		}
+	}
+
+	return out;
+}
+
+// Full round robin plays all N(N-1) games. Swiss plays up to a fixed number of rounds, each pairing individuals with
+// similar running scores who haven't met yet for both colour games, so costs at most N games per round. Rating mode
+// spends the same budget on whichever pairings the current Bradley-Terry fit is least sure about, and ranks by the fit
+// rather than raw winrate, so uneven and sparse schedules still compare fairly. Racing plays the same rounds by
+// successive halving, keeping only the best share of the field after each rung.
+vector<double> evaluate(const vector<Individual>& population, ThreadPool& pool, const TournamentConfig& config, const vector<double>& expectedLengths,
+						ResultCache& cache, TournamentStats& stats) {
+	size_t size = population.size();
+
+	stats.pairingLengths.assign(size, vector<uint>(size, 0));
+	stats.meanLengths.assign(size, 0);
+	stats.gameCounts.assign(size, 0);
+	stats.played = 0;
+	stats.cached = 0;
+	stats.moves = 0;
+	stats.tailTime = 0;
+
+	vector<uint64_t> hashes(size);
+	transform(population.begin(), population.end(), hashes.begin(), [](const Individual& individual) { return individual.hash(); });
+
+	// choices depend on the precision and so only stay valid for this call; tree execution already plays each shared
+	// position once, so it has no use for them
+	unique_ptr<MoveCache> choices = config.cacheMoves && config.execution != Executions::TREE ? make_unique<MoveCache>(hashes) : nullptr;
+	// tree execution scores shared positions for many genomes at once, and lockstep scores many games' candidates at once
+	unique_ptr<PopulationWeights> layout = config.execution != Executions::GAMES ? make_unique<PopulationWeights>(population) : nullptr;
+
+	auto pairing = [&expectedLengths](size_t white, size_t black, size_t opening) -> Pairing {
+		double expected = expectedLengths.empty() ? 0 : expectedLengths[white] + expectedLengths[black];
+
+		return {.white = white, .black = black, .opening = opening, .expectedLength = expected};
+	};
+
+	// reduced in pairing order on this thread, so totals don't depend on which worker played what
+	vector<int> wins(size, 0);
+	vector<Outcome> outcomes;
+	auto settle = [&wins, &outcomes, &stats](const vector<Pairing>& pairings, const vector<optional<GameResult>>& results) {
+		for (size_t k = 0; k < pairings.size(); k++) {
+			if (results[k]) {
+				const Pairing& p = pairings[k];
+
+				wins[results[k]->winner == Players::WHITE ? p.white : p.black]++;
+				outcomes.push_back({.white = p.white, .black = p.black, .whiteWon = results[k]->winner == Players::WHITE});
+				stats.pairingLengths[p.white][p.black] = results[k]->halfMoves;
+				stats.meanLengths[p.white] += results[k]->halfMoves;
+				stats.meanLengths[p.black] += results[k]->halfMoves;
+				stats.gameCounts[p.white]++;
+				stats.gameCounts[p.black]++;
+			}
+		}
+	};
+
+	// Plays every pair both ways from each opening in turn. Pairs whose SPRT has been decided sit out later openings, so
+	// clearly unequal pairs stop after a few games while close ones use the full set.
+	auto playMatches = [&](const vector<pair<size_t, size_t>>& pairs) {
+		vector<SPRT> tests(pairs.size(), SPRT(config.sprt));
+
+		for (size_t opening = 0; opening < config.openings.size(); opening++) {
+			vector<size_t> undecided;
+			vector<Pairing> pairings;
+
+			for (size_t k = 0; k < pairs.size(); k++) {
+				if (tests[k].decision() == SPRTDecisions::CONTINUE) {
+					undecided.push_back(k);
+					pairings.push_back(pairing(pairs[k].first, pairs[k].second, opening));
+					pairings.push_back(pairing(pairs[k].second, pairs[k].first, opening));
+				}
+			}
+
+			if (pairings.empty()) {
+				break;
+			}
+
+			vector<optional<GameResult>> results = playGames(population, hashes, pairings, config, pool, cache, choices.get(), layout.get(), stats);
+			settle(pairings, results);
+
+			for (size_t n = 0; n < undecided.size(); n++) {
+				// errored games give the test nothing to go on
+				if (results[2 * n]) {
+					tests[undecided[n]].add(results[2 * n]->winner == Players::WHITE);
+				}
+				if (results[2 * n + 1]) {
+					tests[undecided[n]].add(results[2 * n + 1]->winner == Players::BLACK);
+				}
+			}
+		}
+	};
+
+	// racing only: how many rungs each individual survived, out of how many were run
+	vector<size_t> rungsSurvived(size, 0);
+	size_t rungs = 0;
+
+	auto start = chrono::steady_clock::now();
+	chrono::nanoseconds busyBefore = pool.busyTime();
+
+	switch (config.mode) {
+		case TournamentModes::ROUND_ROBIN: {
+			vector<pair<size_t, size_t>> pairs;
+			for (size_t i = 0; i < size; i++) {
+				for (size_t j = i + 1; j < size; j++) {
+					pairs.push_back({i, j});
+				}
+			}
+
+			playMatches(pairs);
+			break;
+		}
+		case TournamentModes::SWISS: {
+			vector<vector<bool>> met(size, vector<bool>(size, false));
+
+			for (size_t round = 0; round < config.rounds; round++) {
+				vector<size_t> standings(size);
+				iota(standings.begin(), standings.end(), 0);
+				stable_sort(standings.begin(), standings.end(), [&wins](size_t a, size_t b) { return wins[a] > wins[b]; });
+
+				vector<pair<size_t, size_t>> pairs = swissPairs(standings, met);
+				for (const auto& [a, b] : pairs) {
+					met[a][b] = met[b][a] = true;
+				}
+
+				if (pairs.empty()) {
+					break;
+				}
+
+				playMatches(pairs);
+			}
+			break;
+		}
+		case TournamentModes::RACING: {
+			vector<vector<bool>> met(size, vector<bool>(size, false));
+			vector<size_t> survivors(size);
+			iota(survivors.begin(), survivors.end(), 0);
+
+			auto winrate = [&wins, &stats](size_t i) { return stats.gameCounts[i] == 0 ? 0.5 : (double)wins[i] / stats.gameCounts[i]; };
+			auto byWinrate = [&winrate](size_t a, size_t b) { return winrate(a) > winrate(b); };
+
+			// Each rung plays Swiss rounds among the survivors, then drops all but the best share of them. A rung plays one
+			// round for each time the field has shrunk by its starting size, so every rung costs about the same number of
+			// games and the fewer left get longer to separate.
+			size_t round = 0;
+			bool exhausted = false;
+			while (survivors.size() > 1 && round < config.rounds && !exhausted) {
+				size_t rungRounds = max<size_t>(1, size / survivors.size());
+
+				for (size_t k = 0; k < rungRounds && round < config.rounds; k++, round++) {
+					stable_sort(survivors.begin(), survivors.end(), byWinrate);
+
+					vector<pair<size_t, size_t>> pairs = swissPairs(survivors, met);
+					for (const auto& [a, b] : pairs) {
+						met[a][b] = met[b][a] = true;
+					}
+
+					if (pairs.empty()) {
+						exhausted = true;
+						break;
+					}
+
+					playMatches(pairs);
+				}
+
+				stable_sort(survivors.begin(), survivors.end(), byWinrate);
+				survivors.resize(min(survivors.size(), max<size_t>(2, ceil(survivors.size() * config.keepFraction))));
+
+				for (size_t i : survivors) {
+					rungsSurvived[i]++;
+				}
+				rungs++;
+			}
+
+			size_t roundRobin = size * (size - 1) * config.openings.size();
+			cout << "Racing finished with " << survivors.size() << " contenders after " << round << " rounds, saving "
+				 << (roundRobin - stats.played - stats.cached) << " of " << roundRobin << " round-robin games" << endl;
+			break;
+		}
+		case TournamentModes::RATING: {
+			vector<vector<bool>> met(size, vector<bool>(size, false));
+
+			for (size_t round = 0; round < config.rounds; round++) {
+				vector<pair<size_t, size_t>> pairs = informativePairs(fitBradleyTerry(size, outcomes), met);
+				for (const auto& [a, b] : pairs) {
+					met[a][b] = met[b][a] = true;
+				}
+
+				if (pairs.empty()) {
+					break;
+				}
+
+				playMatches(pairs);
+			}
+			break;
+		}
+	}
+
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	chrono::duration<double> busy = pool.busyTime() - busyBefore;
+
+	cout << "Played " << stats.played << " games (" << stats.cached << " more from cache) in " << elapsed.count() << "s choosing " << stats.moves
+		 << " moves, worker utilisation "
+		 << (busy / (elapsed * pool.size()) * 100) << "%" << endl;
+
+	if (choices) {
+		// hit rates over growing stretches of the game, as they fall off quickly once the opponents' replies diverge
+		const vector<uint> BANDS = {0, 1, 2, 4, 8, 16, 32, 64, 128, MoveCache::MAX_DEPTH + 1};
+
+		cout << "Move cache hit rate by half-move:";
+		for (size_t band = 0; band + 1 < BANDS.size(); band++) {
+			size_t lookups = 0, hits = 0;
+			for (uint depth = BANDS[band]; depth < BANDS[band + 1]; depth++) {
+				lookups += choices->lookups(depth);
+				hits += choices->hits(depth);
+			}
+
+			if (lookups > 0) {
+				cout << " " << BANDS[band] << (BANDS[band + 1] - BANDS[band] > 1 ? "-" + to_string(BANDS[band + 1] - 1) : "") << ": "
+					 << (100.0 * hits / lookups) << "%";
+			}
+		}
+		cout << endl;
+	}
+
+	vector<double> winrates(size, 0);
+	for (size_t i = 0; i < size; i++) {
+		if (stats.gameCounts[i] > 0) {
+			stats.meanLengths[i] /= stats.gameCounts[i];
+			winrates[i] = (double)wins[i] / stats.gameCounts[i];
+		}
+	}
+
+	if (config.mode == TournamentModes::RATING) {
+		return expectedScores(fitBradleyTerry(size, outcomes));
+	}
+
+	// Survivors only meet other winners, so their winrates fall while those they knocked out keep the ones they had.
+	// Ranking by the rungs survived first and winrate second puts everyone eliminated below those who outlasted them.
+	if (config.mode == TournamentModes::RACING) {
+		for (size_t i = 0; i < size; i++) {
+			winrates[i] = (rungsSurvived[i] + winrates[i]) / (rungs + 1);
+		}
+	}
+
+	return winrates;
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cache.h"
+#include "game.h"
+#include "movecache.h"
+#include "pool.h"
+#include "population.h"
+#include "representation.h"
+#include "sprt.h"
+
+enum class TournamentModes { ROUND_ROBIN, SWISS, RATING, RACING };
+
+// How a batch of games is run. GAMES plays each game as its own task. TREE plays all games from one opening together as
+// a tree, forking wherever their moves diverge, so a prefix shared by many games is only played once. LOCKSTEP has each
+// task advance several games a ply at a time, one step of the ply across all of them before the next. Results are the
+// same every way.
+enum class Executions { GAMES, TREE, LOCKSTEP };
+
+struct TournamentConfig {
+	TournamentModes mode;
+	std::size_t rounds;	  // swiss, rating and racing only
+	double keepFraction;  // racing only: share of survivors kept after each rung
+
+	// Every pairing is played from each of these start positions in turn (both colours each), until its SPRT reaches a
+	// decision or they run out. A single opening keeps the original one-position, two-game matches.
+	std::vector<Game> openings;
+	SPRTConfig sprt;
+
+	Precisions precision;  // scalar type games are evaluated in
+	bool cacheMoves;	   // remember each individual's move choices for the rest of the generation; not used by tree execution
+	Executions execution;
+	std::size_t lockstep;  // games per task under lockstep execution
+};
+
+struct GameResult {
+	Players winner;
+	uint halfMoves;
+};
+
+// one colour game between two members of the population
+struct Pairing {
+	std::size_t white, black;
+	std::size_t opening;	// index into TournamentConfig::openings
+	double expectedLength;	// predicted half-moves, used to start long games first
+};
+
+// per-generation scheduling measurements
+struct TournamentStats {
+	std::vector<std::vector<uint>> pairingLengths;	// half-moves, indexed [white][black]
+	std::vector<double> meanLengths;				// per individual, over all of its games
+	std::vector<uint> gameCounts;					// games each individual took part in
+	std::size_t played;								// games actually played, as opposed to answered by the cache
+	std::size_t cached;
+	std::size_t moves;	// moves chosen by playing games, shared ones counting once under tree execution
+	double tailTime;  // seconds from the last game starting to the last game finishing, summed over batches
+};
+
+// identifies a game by the content of its players; play is deterministic, so this fixes the result
+struct GameKey {
+	uint64_t white, black;
+	std::size_t opening;
+
+	bool operator==(const GameKey& other) const { return white == other.white && black == other.black && opening == other.opening; }
+};
+
+struct GameKeyHash {
+	std::size_t operator()(const GameKey& key) const { return key.white ^ (key.black * 0x9e3779b97f4a7c15) ^ (key.opening * 0xbf58476d1ce4e5b9); }
+};
+
+typedef LRUCache<GameKey, GameResult, GameKeyHash> ResultCache;
+
+class GameError : public std::runtime_error {
+public:
+	GameError(const std::string& what, const std::string& fen) : std::runtime_error(what.c_str()), _fen(fen) {}
+
+	std::string fen() const {
+		return _fen;
+	}
+
+private:
+	std::string _fen;
+};
+
+// the standard start position followed by count - 1 distinct positions two plies in, spread across all of them
+std::vector<Game> openingPositions(std::size_t count);
+
+// One game from start, each side moving by its own evaluation; this is the unit of work the scheduler hands out, and
+// matches are assembled from its results afterwards. With choices, a side replays the move it chose before in a
+// position instead of scoring the candidates again; the game goes exactly as it would without.
+GameResult playGame(const Individual& white, const Individual& black, const Game& start = Game(), Precisions precision = Precisions::DOUBLE,
+					MoveCache* choices = nullptr);
+
+// Plays a batch of games on the pool and returns their results in the order given; games that hit an engine error have
+// no result. Cached games are answered without playing and the rest are started longest-expected-first. layout, when
+// given, must hold population; tree execution uses it to score shared positions for every mover at once, and lockstep
+// execution to score the candidates of all its games together.
+std::vector<std::optional<GameResult>> playGames(const std::vector<Individual>& population, const std::vector<uint64_t>& hashes,
+												 const std::vector<Pairing>& pairings, const TournamentConfig& config, ThreadPool& pool, ResultCache& cache,
+												 MoveCache* choices, const PopulationWeights* layout, TournamentStats& stats);
+
+// Returns each individual's winrate, for rating mode its expected score against the field, and for racing its winrate
+// offset by the rungs it survived, so the eliminated rank below everyone who outlasted them. expectedLengths
+// (predicted half-moves per individual, may be empty) orders games longest-first.
+std::vector<double> evaluate(const std::vector<Individual>& population, ThreadPool& pool, const TournamentConfig& config,
+							 const std::vector<double>& expectedLengths, ResultCache& cache, TournamentStats& stats);
+
+#endif
\ No newline at end of file
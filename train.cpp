@@ -1,13 +1,16 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <mutex>
-#include <thread>
+#include <string>
+#include <utility>
 #include <vector>
 
-#include "engine/chess.h"
+#include "bitboard.h"
+#include "game.h"
+#include "pool.h"
 #include "representation.h"
 #include "rng.h"
+#include "tournament.h"
 
 using namespace std;
 
@@ -17,55 +20,135 @@ using json = nlohmann::json;
 #define GENERATIONS 10000
 #define MUTATION_FREQ 0.2
 
-struct MatchResults {
-	int a, b;
-};
-
-MatchResults match(const Individual& a, const Individual& b);
+int main(int argc, char** argv) {
+	size_t threads = 0;	 // one worker per hardware thread
+	size_t cacheSize = 1 << 20;
+	size_t openings = 1;
+	TournamentConfig config = {.mode = TournamentModes::ROUND_ROBIN,
+							   .rounds = 7,
+							   .keepFraction = 0.5,
+							   .openings = {},
+							   .sprt = {.alpha = 0.05, .beta = 0.05, .margin = 0.2},
+							   .precision = Precisions::DOUBLE,
+							   .cacheMoves = true,
+							   .execution = Executions::GAMES,
+							   .lockstep = 8};
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i], value = i + 1 < argc ? argv[i + 1] : "";
+
+		if (arg == "--threads" && !value.empty()) {
+			threads = stoul(value);
+		} else if (arg == "--cache-size" && !value.empty()) {
+			cacheSize = stoul(value);
+		} else if (arg == "--mode" && value == "round-robin") {
+			config.mode = TournamentModes::ROUND_ROBIN;
+		} else if (arg == "--mode" && value == "swiss") {
+			config.mode = TournamentModes::SWISS;
+		} else if (arg == "--mode" && value == "rating") {
+			config.mode = TournamentModes::RATING;
+		} else if (arg == "--mode" && value == "racing") {
+			config.mode = TournamentModes::RACING;
+		} else if (arg == "--rounds" && !value.empty()) {
+			config.rounds = stoul(value);
+		} else if (arg == "--keep" && !value.empty()) {
+			config.keepFraction = stod(value);
+		} else if (arg == "--openings" && !value.empty()) {
+			openings = stoul(value);
+		} else if (arg == "--alpha" && !value.empty()) {
+			config.sprt.alpha = stod(value);
+		} else if (arg == "--beta" && !value.empty()) {
+			config.sprt.beta = stod(value);
+		} else if (arg == "--margin" && !value.empty()) {
+			config.sprt.margin = stod(value);
+		} else if (arg == "--precision" && value == "double") {
+			config.precision = Precisions::DOUBLE;
+		} else if (arg == "--precision" && value == "float") {
+			config.precision = Precisions::FLOAT;
+		} else if (arg == "--precision" && value == "int16") {
+			config.precision = Precisions::FIXED16;
+		} else if (arg == "--move-cache" && value == "on") {
+			config.cacheMoves = true;
+		} else if (arg == "--move-cache" && value == "off") {
+			config.cacheMoves = false;
+		} else if (arg == "--execution" && value == "games") {
+			config.execution = Executions::GAMES;
+		} else if (arg == "--execution" && value == "tree") {
+			config.execution = Executions::TREE;
+		} else if (arg == "--execution" && value == "lockstep") {
+			config.execution = Executions::LOCKSTEP;
+		} else if (arg == "--lockstep" && !value.empty()) {
+			config.lockstep = stoul(value);
+		} else if (arg == "--sliders" && value == "magic") {
+			BitboardGame::setSliderLookup(SliderLookups::MAGIC);
+		} else if (arg == "--sliders" && value == "pext") {
+			BitboardGame::setSliderLookup(SliderLookups::PEXT);
+		} else {
+			cerr << "Usage: " << argv[0] << " [--threads N] [--cache-size GAMES] [--mode round-robin|swiss|rating|racing] [--rounds N]"
+				 << " [--keep FRACTION] [--openings N] [--alpha A] [--beta B] [--margin M]"
+				 << " [--precision double|float|int16] [--move-cache on|off] [--execution games|tree|lockstep] [--lockstep GAMES]"
+				 << " [--sliders magic|pext]" << endl;
+			return 1;
+		}
 
-vector<double> evaluate(const vector<Individual>& population);
+		i++;
+	}
 
-class GameError : public runtime_error {
-public:
-	GameError(const string& what, const string& fen) : runtime_error(what.c_str()), _fen(fen) {}
+	// outside these ranges the SPRT's bounds or step are infinite or NaN, and it decides on the first game or never
+	if (!(config.sprt.alpha > 0 && config.sprt.alpha < 1) || !(config.sprt.beta > 0 && config.sprt.beta < 1) ||
+		!(config.sprt.margin > 0 && config.sprt.margin < 0.5)) {
+		cerr << "--alpha and --beta must be strictly between 0 and 1, and --margin strictly between 0 and 0.5" << endl;
+		return 1;
+	}
 
-	string fen() const {
-		return _fen;
+	// a share of survivors to keep, so at least something must be kept and no more than all of them
+	if (!(config.keepFraction > 0 && config.keepFraction <= 1)) {
+		cerr << "--keep must be greater than 0 and at most 1" << endl;
+		return 1;
 	}
 
-private:
-	string _fen;
-};
+	config.openings = openingPositions(max<size_t>(openings, 1));
+
+	ThreadPool pool(threads);
+	cout << "Evaluating with " << pool.size() << " worker threads" << endl;
+
+	// results outlive the generation they were played in, so clones and unchanged genomes never replay a game
+	ResultCache cache(cacheSize);
 
-int main() {
 	vector<Individual> population;
-	vector<double> fitnesses;
+	vector<double> fitnesses, expectedLengths;
+	TournamentStats stats;
 
 	for (int i = 0; i < POP_SIZE; i++) {
 		population.push_back(Individual());
 	}
 
 	for (int gen = 0; gen < GENERATIONS; gen++) {
-		fitnesses = evaluate(population);
+		fitnesses = evaluate(population, pool, config, expectedLengths, cache, stats);
 
 		double maxFitness = *max_element(fitnesses.begin(), fitnesses.end());
 
-		cout << (gen / 100) << "% complete, max fitness " << maxFitness << endl;
+		cout << (gen / 100) << "% complete, max fitness " << maxFitness << ", tail time " << stats.tailTime << "s, cache hit rate "
+			 << ((double)stats.cached / (stats.played + stats.cached) * 100) << "%" << endl;
 
 		vector<Individual> descendants;
+		expectedLengths.clear();
 
 		for (int i = 0; i < POP_SIZE; i++) {
-			Individual parentA = rng::choice(population, fitnesses);
-			Individual parentB = rng::choice(population, fitnesses);
+			size_t parentA = rng::weightedRand(fitnesses);
+			size_t parentB = rng::weightedRand(fitnesses);
 
-			descendants.push_back(mutate(cross(parentA, parentB), MUTATION_FREQ));
+			descendants.push_back(mutate(cross(population[parentA], population[parentB]), MUTATION_FREQ));
+
+			// children are expected to play games about as long as their parents did
+			expectedLengths.push_back((stats.meanLengths[parentA] + stats.meanLengths[parentB]) / 2);
 		}
 
 		// kill parents strategy
-		population = descendants;
+		population = move(descendants);
 	}
 
-	fitnesses = evaluate(population);
+	fitnesses = evaluate(population, pool, config, expectedLengths, cache, stats);
 
 	json report = json::array();
 	for (int i = 0; i < POP_SIZE; i++) {
@@ -79,210 +162,4 @@ int main() {
 	dump.close();
 
 	return 0;
-}
-
-MatchResults match(const Individual& a, const Individual& b) {
-	MatchResults out = {.a = 0, .b = 0};
-
-	uint halfMoves = 0;
-	Game aWhite;
-
-	try {
-		while (aWhite.getAvailableMoves().size() > 0 && halfMoves < 200) {
-			vector<Move> moves = aWhite.getAvailableMoves();
-			vector<double> advantages(moves.size());
-
-			if (aWhite.turn() == Players::WHITE) {
-				transform(moves.begin(), moves.end(), advantages.begin(),
-						  [&a, &aWhite](const Move& move) { return a.evaluatePosition(aWhite.branch(move), Players::WHITE); });
-			} else {
-				transform(moves.begin(), moves.end(), advantages.begin(),
-						  [&b, &aWhite](const Move& move) { return b.evaluatePosition(aWhite.branch(move), Players::BLACK); });
-			}
-
-			size_t currMax = 0;
-			for (size_t i = 1; i < moves.size(); i++) {
-				if (advantages[i] > advantages[currMax]) {
-					currMax = i;
-				}
-			}
-
-			bool shouldPromote = aWhite.move(moves[currMax]);
-
-			if (shouldPromote) {
-				Position promotionSquare = moves[currMax].to;
-				vector<double> advantages;
-
-				if (aWhite.turn() == Players::WHITE) {
-					for (PieceTypes piece = PieceTypes::KNIGHT; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-						advantages.push_back(a.evaluatePosition(aWhite.branchPromote(promotionSquare, piece), Players::WHITE));
-					}
-				} else {
-					for (PieceTypes piece = PieceTypes::KNIGHT; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-						advantages.push_back(b.evaluatePosition(aWhite.branchPromote(promotionSquare, piece), Players::BLACK));
-					}
-				}
-
-				PieceTypes promoteTo = PieceTypes::KNIGHT;
-				for (PieceTypes piece = PieceTypes::BISHOP; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-					if (advantages[piece - PieceTypes::KNIGHT] > advantages[promoteTo - PieceTypes::KNIGHT]) {
-						promoteTo = piece;
-					}
-				}
-
-				aWhite.promote(promotionSquare, promoteTo);
-			}
-
-			halfMoves++;
-		}
-
-		if (aWhite.getAvailableMoves().size() == 0) {
-			// black is checkmated
-			if (aWhite.turn() == Players::BLACK) {
-				out.a++;
-			} else {
-				out.b++;
-			}
-		} else {
-			// tiebreak by materiel
-			if (aWhite.materiel(Players::WHITE) > aWhite.materiel(Players::BLACK)) {
-				out.a++;
-			} else {
-				out.b++;
-			}
-		}
-	} catch (const runtime_error& e) {
-		throw GameError(e.what(), aWhite.dumpFEN());
-	}
-
-	// repeat, for b being white
-	halfMoves = 0;
-	Game bWhite;
-
-	try {
-		while (bWhite.getAvailableMoves().size() > 0 && halfMoves < 200) {
-			vector<Move> moves = bWhite.getAvailableMoves();
-			vector<double> advantages(moves.size());
-
-			if (bWhite.turn() == Players::WHITE) {
-				transform(moves.begin(), moves.end(), advantages.begin(),
-						  [&b, &bWhite](const Move& move) { return b.evaluatePosition(bWhite.branch(move), Players::WHITE); });
-			} else {
-				transform(moves.begin(), moves.end(), advantages.begin(),
-						  [&a, &bWhite](const Move& move) { return a.evaluatePosition(bWhite.branch(move), Players::BLACK); });
-			}
-
-			size_t currMax = 0;
-			for (size_t i = 1; i < moves.size(); i++) {
-				if (advantages[i] > advantages[currMax]) {
-					currMax = i;
-				}
-			}
-
-			bool shouldPromote = bWhite.move(moves[currMax]);
-
-			if (shouldPromote) {
-				Position promotionSquare = moves[currMax].to;
-				vector<double> advantages;
-
-				if (bWhite.turn() == Players::WHITE) {
-					for (PieceTypes piece = PieceTypes::KNIGHT; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-						advantages.push_back(b.evaluatePosition(bWhite.branchPromote(promotionSquare, piece), Players::WHITE));
-					}
-				} else {
-					for (PieceTypes piece = PieceTypes::KNIGHT; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-						advantages.push_back(a.evaluatePosition(bWhite.branchPromote(promotionSquare, piece), Players::BLACK));
-					}
-				}
-
-				PieceTypes promoteTo = PieceTypes::KNIGHT;
-				for (PieceTypes piece = PieceTypes::BISHOP; piece <= PieceTypes::QUEEN; piece = (PieceTypes)((int)piece + 1)) {
-					if (advantages[piece - PieceTypes::KNIGHT] > advantages[promoteTo - PieceTypes::KNIGHT]) {
-						promoteTo = piece;
-					}
-				}
-
-				bWhite.promote(promotionSquare, promoteTo);
-			}
-
-			halfMoves++;
-		}
-
-		if (bWhite.getAvailableMoves().size() == 0) {
-			// black is checkmated
-			if (bWhite.turn() == Players::BLACK) {
-				out.b++;
-			} else {
-				out.a++;
-			}
-		} else {
-			// tiebreak by materiel
-			if (bWhite.materiel(Players::WHITE) > bWhite.materiel(Players::BLACK)) {
-				out.b++;
-			} else {
-				out.a++;
-			}
-		}
-	} catch (const runtime_error& e) {
-		throw GameError(e.what(), bWhite.dumpFEN());
-	}
-
-	return out;
-}
-
-// round-robin tournament selection
-vector<double> evaluate(const vector<Individual>& population) {
-	vector<int> wins(population.size(), 0);
-
-	mutex lock;
-	vector<thread> threads;
-	for (size_t i = 0; i < population.size(); i++) {
-		for (size_t j = i + 1; j < population.size(); j++) {
-			try {
-				threads.push_back(thread(
-					[&lock, &wins, &i, &j](const Individual& a, const Individual& b) {
-						unique_lock guard(lock, defer_lock);
-
-						try {
-							MatchResults results = match(a, b);
-
-							guard.lock();
-							wins[i] += results.a;
-							wins[j] += results.b;
-							guard.unlock();
-						} catch (const GameError& e) {
-							if (guard) {  // this case should theoretically never exist, but who knows :P
-								cerr << "Game error: " << e.what() << endl;
-								cerr << "FEN Dump: " << e.fen() << endl;
-							} else {
-								guard.lock();
-								cerr << "Game error: " << e.what() << endl;
-								cerr << "FEN Dump: " << e.fen() << endl;
-								guard.unlock();
-							}
-						}
-					},
-					population[i], population[j]));
-			} catch (const system_error& e) {
-				cerr << "Starting thread error: " << e.what() << endl;
-				j--;
-			} catch (...) {
-				cerr << "Starting thread unknown error" << endl;
-			}
-		}
-	}
-
-	unique_lock mainGuard(lock, defer_lock);
-	for (size_t i = 0; i < threads.size(); i++) {
-		threads[i].join();
-
-		mainGuard.lock();
-		cout << "Evaluation " << ((double)i / (population.size() * (population.size() - 1)) * 100) << "% complete" << endl;
-		mainGuard.unlock();
-	}
-
-	vector<double> winrates(population.size());
-	transform(wins.begin(), wins.end(), winrates.begin(), [&population](const int& wins) { return (double)wins / (population.size() * 2 - 2); });
-
-	return winrates;
 }
\ No newline at end of file